@@ -1,16 +1,37 @@
 TEMPLATE = app
-CONFIG += console c++11
+CONFIG += console c++17 thread
 CONFIG -= app_bundle
 CONFIG -= qt
 
 SOURCES += src/main.cpp \
+    src/concurrentsequencetrie.cpp \
+    src/corpusreader.cpp \
+    src/mappedfile.cpp \
+    src/sequencechildren.cpp \
+    src/sequencegenerator.cpp \
+    src/sequencelanguagemodel.cpp \
+    src/sequencesuffixarray.cpp \
     src/stringsequencetrie.cpp \
-    src/stringtrie.cpp
+    src/stringtrie.cpp \
+    src/tokenpipeline.cpp
 
 HEADERS += \
     src/binarytree.h \
+    include/concurrentqueue.h \
+    include/concurrentsequencetrie.h \
+    include/concurrentskiplist.h \
+    include/corpusreader.h \
+    include/epochreclaimer.h \
+    include/intrusivelist.h \
+    include/mappedfile.h \
+    include/sequencechildren.h \
+    include/sequencegenerator.h \
+    include/sequencelanguagemodel.h \
+    include/sequencesuffixarray.h \
     src/stringsequencetrie.h \
     src/stringtrie.h \
+    include/tokenpipeline.h \
+    include/unrolledlinkedlist.h \
     src/binaryheap.h \
     src/linkedlist.h \
     src/skiplist.h
@@ -0,0 +1,244 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+
+#ifndef CONCURRENTQUEUE_H_
+#define CONCURRENTQUEUE_H_
+
+#include <atomic>
+#include <new>
+#include <thread>
+#include <utility>
+
+#include "epochreclaimer.h"
+
+template<class T>
+struct ConcurrentQueueNode {
+  std::atomic<ConcurrentQueueNode<T>*> next;
+  // link in the lists of nodes waiting to be reused. kept apart from next,
+  // which threads that haven't noticed the node leaving may still read
+  ConcurrentQueueNode<T>* next_retired;
+  // holds a T while the node is queued, the sentinel holds none
+  alignas(T) unsigned char storage[sizeof(T)];
+
+  ConcurrentQueueNode() : next(nullptr), next_retired(nullptr) {}
+  T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
+};
+
+// Unbounded multi producer, multi consumer FIFO queue that never locks
+// (Michael and Scott's queue). Like LinkedList it starts from a sentinel
+// head node: the first element is the one after head, and removing it
+// makes its node the new sentinel. Producers link nodes in after tail with
+// a compare and swap and consumers swing head forward the same way.
+//
+// A removed node can still be read by threads that loaded head before it
+// moved, so it goes to an EpochReclaimer until no thread can. Nodes it
+// hands back are kept for reuse by later inserts, as LinkedList does, so
+// a queue in steady use stops allocating.
+template<class T>
+class ConcurrentQueue {
+ public:
+  ConcurrentQueue();
+  ~ConcurrentQueue();
+
+  ConcurrentQueue(const ConcurrentQueue&) = delete;
+  ConcurrentQueue& operator=(const ConcurrentQueue&) = delete;
+
+  // adds value to the end of the queue, safe to call from any thread
+  void insertEnd(const T& value);
+  void insertEnd(T&& value);
+  // constructs an element from args at the end of the queue
+  template<class... Args>
+  void emplaceEnd(Args&&... args);
+
+  // moves the first element into value and removes it. returns false,
+  // leaving value alone, if the queue is empty
+  bool removeFirst(T* value);
+
+  // true if the queue was empty at some point during the call
+  bool isEmpty() const;
+
+ private:
+  typedef ConcurrentQueueNode<T> Node;
+  typedef EpochReclaimer<Node> Reclaimer;
+
+  // free nodes of the threads in one of the reclaimer's slots
+  struct alignas(64) AllocationSlot {
+    // guards free_nodes, held only by threads of this slot
+    std::atomic_flag allocating;
+    // nodes this slot's threads insert with, taken from the queue's free
+    // nodes when it runs out
+    Node* free_nodes;
+  };
+
+  // takes a free node, or allocates one if there are none
+  Node* createNode();
+  void linkEnd(Node* node);
+  // adds the nodes linked through next_retired from first on to the free
+  // nodes
+  void recycle(Node* first);
+  // deletes the nodes linked through next_retired from node on
+  static void deleteNodes(Node* node);
+
+  alignas(64) std::atomic<Node*> m_head;
+  alignas(64) std::atomic<Node*> m_tail;
+  // reclaimed nodes, taken whole by a slot that has run out
+  alignas(64) std::atomic<Node*> m_free_nodes;
+  AllocationSlot m_allocation_slots[Reclaimer::kThreadSlots];
+  mutable Reclaimer m_reclaimer;
+};
+
+template<class T>
+ConcurrentQueue<T>::ConcurrentQueue() {
+  Node* sentinel = new Node();
+  m_head.store(sentinel);
+  m_tail.store(sentinel);
+  m_free_nodes.store(nullptr);
+  for (AllocationSlot& slot : m_allocation_slots) {
+    slot.allocating.clear();
+    slot.free_nodes = nullptr;
+  }
+}
+
+// must not run while other threads use the queue
+template<class T>
+ConcurrentQueue<T>::~ConcurrentQueue() {
+  Node* current = m_head.load();
+  Node* next = current->next.load();
+  delete current;
+  for (current = next; current != nullptr; current = next) {
+    next = current->next.load();
+    current->value()->~T();
+    delete current;
+  }
+  deleteNodes(m_reclaimer.takeRetired());
+  deleteNodes(m_free_nodes.load());
+  for (AllocationSlot& slot : m_allocation_slots) deleteNodes(slot.free_nodes);
+}
+
+template<class T>
+void ConcurrentQueue<T>::insertEnd(const T& value) {
+  emplaceEnd(value);
+}
+
+template<class T>
+void ConcurrentQueue<T>::insertEnd(T&& value) {
+  emplaceEnd(std::move(value));
+}
+
+template<class T>
+template<class... Args>
+void ConcurrentQueue<T>::emplaceEnd(Args&&... args) {
+  Node* node = createNode();
+  try {
+    new (node->storage) T(std::forward<Args>(args)...);
+  } catch (...) {
+    delete node;
+    throw;
+  }
+  linkEnd(node);
+}
+
+template<class T>
+typename ConcurrentQueue<T>::Node* ConcurrentQueue<T>::createNode() {
+  AllocationSlot& slot = m_allocation_slots[Reclaimer::threadSlot()];
+  while (slot.allocating.test_and_set(std::memory_order_acquire))
+    std::this_thread::yield();
+  if (slot.free_nodes == nullptr) slot.free_nodes = m_free_nodes.exchange(nullptr);
+  Node* node = slot.free_nodes;
+  if (node != nullptr) slot.free_nodes = node->next_retired;
+  slot.allocating.clear(std::memory_order_release);
+  if (node == nullptr) return new Node();
+  node->next.store(nullptr, std::memory_order_relaxed);
+  return node;
+}
+
+// links node after the last node, then moves tail to it. tail may lag one
+// node behind, any thread finding it so moves it on before going further
+template<class T>
+void ConcurrentQueue<T>::linkEnd(Node* node) {
+  typename Reclaimer::Guard guard(m_reclaimer);
+  while (true) {
+    Node* last = m_tail.load();
+    Node* next = last->next.load();
+    if (last != m_tail.load()) continue;
+    if (next != nullptr) {
+      m_tail.compare_exchange_weak(last, next);
+    } else if (last->next.compare_exchange_weak(next, node)) {
+      m_tail.compare_exchange_strong(last, node);
+      return;
+    }
+  }
+}
+
+// only the thread whose compare and swap moves head past a node takes its
+// value. the node stays allocated while the guard is held, even if
+// other consumers remove it as the sentinel in the meantime
+template<class T>
+bool ConcurrentQueue<T>::removeFirst(T* value) {
+  typename Reclaimer::Guard guard(m_reclaimer);
+  while (true) {
+    Node* first = m_head.load();
+    Node* last = m_tail.load();
+    Node* next = first->next.load();
+    if (first != m_head.load()) continue;
+    if (next == nullptr) return false;
+    if (first == last) {
+      // tail lags behind, the sentinel can't be retired while it's tail
+      m_tail.compare_exchange_weak(last, next);
+    } else if (m_head.compare_exchange_weak(first, next)) {
+      *value = std::move(*next->value());
+      next->value()->~T();
+      recycle(m_reclaimer.retire(first, guard));
+      return true;
+    }
+  }
+}
+
+template<class T>
+bool ConcurrentQueue<T>::isEmpty() const {
+  typename Reclaimer::Guard guard(m_reclaimer);
+  return m_head.load()->next.load() == nullptr;
+}
+
+template<class T>
+void ConcurrentQueue<T>::recycle(Node* first) {
+  if (first == nullptr) return;
+  Node* last = first;
+  while (last->next_retired != nullptr) last = last->next_retired;
+  last->next_retired = m_free_nodes.load();
+  while (!m_free_nodes.compare_exchange_weak(last->next_retired, first)) {}
+}
+
+template<class T>
+void ConcurrentQueue<T>::deleteNodes(Node* node) {
+  while (node != nullptr) {
+    Node* next = node->next_retired;
+    delete node;
+    node = next;
+  }
+}
+
+#endif  // CONCURRENTQUEUE_H_
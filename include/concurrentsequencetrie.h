@@ -0,0 +1,128 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+#ifndef CONCURRENTSEQUENCETRIE_H_
+#define CONCURRENTSEQUENCETRIE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "stringsequencetrie.h"
+
+// A StringSequenceTrie that many threads can query while one thread at a
+// time adds text. Two copies of the trie are kept: readers query the
+// published one, the writer changes the other, and publish() swaps them
+// with an atomic index. Readers never lock or wait. Each one marks itself
+// as active in the current epoch, on a counter shared with few other
+// threads. After a swap the writer waits for the readers of the older
+// epoch to leave, then replays the published changes on the copy they were
+// reading so it can take the next ones (the left-right technique). Memory
+// use and write work are doubled in exchange for queries being unaffected
+// by ingest.
+class ConcurrentSequenceTrie {
+ public:
+  // keeps one published version readable, and unchanged, while it's held.
+  // hold it for a query or a batch of queries, a writer publishing waits
+  // for it to be released. word ids and node pointers are only meaningful
+  // within the snapshot they came from
+  class Snapshot {
+   public:
+    Snapshot(Snapshot &&other);
+    ~Snapshot();
+
+    Snapshot(const Snapshot &) = delete;
+    Snapshot &operator=(const Snapshot &) = delete;
+    Snapshot &operator=(Snapshot &&) = delete;
+
+    const StringSequenceTrie &operator*() const { return *m_trie; }
+    const StringSequenceTrie* operator->() const { return m_trie; }
+
+   private:
+    friend class ConcurrentSequenceTrie;
+    Snapshot(std::atomic<int>* readers, const StringSequenceTrie* trie)
+        : m_readers(readers), m_trie(trie) {}
+
+    std::atomic<int>* m_readers;
+    const StringSequenceTrie* m_trie;
+  };
+
+  ConcurrentSequenceTrie();
+
+  ConcurrentSequenceTrie(const ConcurrentSequenceTrie&) = delete;
+  ConcurrentSequenceTrie& operator=(const ConcurrentSequenceTrie&) = delete;
+
+  // the latest published version, safe to call from any thread
+  Snapshot read() const;
+
+  // applies change to the unpublished version, readers see it after the
+  // next publish. change is kept and applied to the other version as well
+  // during publish, so it must have the same effect both times
+  void update(const std::function<void(StringSequenceTrie*)> &change);
+
+  // shortcuts for update
+  void addSequence(const std::vector<std::string> &sequence,
+                   int window_size = 5);
+  void addText(const std::string &text, int window_size = 5);
+  void loadTextFile(const std::string &file_name, int window_size = 5);
+
+  // makes every update so far visible to new readers, waiting for readers
+  // of the version before to finish. returns the new version number
+  std::size_t publish();
+
+  // number of times publish has been called
+  std::size_t getVersion() const { return m_version.load(); }
+
+ private:
+  // readers hash to one of these, so threads rarely share a counter
+  static const int kReaderSlots = 32;
+
+  struct alignas(64) ReaderSlot {
+    std::atomic<int> readers[2];
+  };
+
+  // true once no reader in epoch is left
+  bool hasReaders(int epoch) const;
+
+  void waitForReaders(int epoch) const;
+
+  // readers of an epoch announce themselves here
+  mutable ReaderSlot m_slots[kReaderSlots];
+  std::atomic<int> m_epoch;
+  // index of the published trie
+  std::atomic<int> m_published;
+  std::atomic<std::size_t> m_version;
+
+  StringSequenceTrie m_tries[2];
+  // changes made to the unpublished trie since the last publish
+  std::vector<std::function<void(StringSequenceTrie*)>> m_pending;
+  // serializes writers, readers never take it
+  std::mutex m_writer_mutex;
+};
+
+#endif  // CONCURRENTSEQUENCETRIE_H_
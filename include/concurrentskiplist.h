@@ -0,0 +1,395 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+
+#ifndef CONCURRENTSKIPLIST_H_
+#define CONCURRENTSKIPLIST_H_
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <random>
+#include <thread>
+#include <utility>
+
+#include "epochreclaimer.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// DECLARATIONS
+///////////////////////////////////////////////////////////////////////////////
+
+// ConcurrentSkipList node, allocated with its tower of next links right
+// after it like SkipListNode
+template<class T>
+struct ConcurrentSkipListNode {
+  T data;
+  // number of links in the tower
+  int level;
+  // set once the node is linked in on every level of its tower
+  std::atomic<bool> fully_linked;
+  // set, under the node's lock, when it's being removed
+  std::atomic<bool> marked;
+  // held while the node's links are changed or its removal is started
+  std::atomic_flag locked;
+  // link in the reclaimer's lists
+  ConcurrentSkipListNode* next_retired;
+
+  // allocates a node with a tower of level null links, data constructed
+  // from args
+  template<class... Args>
+  static ConcurrentSkipListNode* create(int level, Args&&... args);
+  // destroys and frees a node made by create
+  static void destroy(ConcurrentSkipListNode* node);
+
+  // the link to the next node on level i, i below level
+  std::atomic<ConcurrentSkipListNode*>& next(int i) const { return tower()[i]; }
+
+  void lock();
+  void unlock() { locked.clear(std::memory_order_release); }
+
+ private:
+  template<class... Args>
+  explicit ConcurrentSkipListNode(int node_level, Args&&... args)
+      : data(std::forward<Args>(args)...), level(node_level),
+        fully_linked(false), marked(false), next_retired(nullptr) {
+    locked.clear();
+  }
+  ~ConcurrentSkipListNode() {}
+
+  // offset of the tower from the start of the node
+  static std::size_t towerOffset() {
+    typedef std::atomic<ConcurrentSkipListNode*> Link;
+    return (sizeof(ConcurrentSkipListNode) + alignof(Link) - 1) / alignof(Link) *
+           alignof(Link);
+  }
+  std::atomic<ConcurrentSkipListNode*>* tower() const {
+    return reinterpret_cast<std::atomic<ConcurrentSkipListNode*>*>(
+        reinterpret_cast<char*>(const_cast<ConcurrentSkipListNode*>(this)) +
+        towerOffset());
+  }
+};
+
+// Ordered set that many threads can insert into, remove from and search at
+// once (the lazy skip list of Herlihy, Lev, Luchangco and Shavit).
+// Searches take no locks and never wait, except on a node being linked in
+// right then. Insert and remove search without locks too, then lock just
+// the predecessors they change, check nothing changed around them in the
+// meantime, and search again if it did. A node is removed by marking it
+// first, which makes it invisible to searches, then unlinking it. Unlinked
+// nodes go to an EpochReclaimer, as searches may still be passing through
+// them.
+//
+// Node levels are drawn from a generator per thread, so inserts share no
+// state besides the nodes they link into.
+template<class T, class CompareFunc = std::less<T>>
+class ConcurrentSkipList {
+ public:
+  typedef ConcurrentSkipListNode<T> Node;
+
+  ConcurrentSkipList();
+  // must not run while other threads use the list
+  ~ConcurrentSkipList();
+
+  ConcurrentSkipList(const ConcurrentSkipList&) = delete;
+  ConcurrentSkipList& operator=(const ConcurrentSkipList&) = delete;
+
+  // inserts value, returns false if an equal value was already in the list
+  bool insert(const T& value);
+
+  // removes value, returns false if it wasn't in the list
+  bool remove(const T& value);
+
+  // returns true if value is in the list
+  bool contains(const T& value) const;
+
+  // returns number of elements in the list, exact while no insert or
+  // remove is under way
+  int getLength() const;
+
+  // returns true if list is empty
+  bool isEmpty() const { return getLength() == 0; }
+
+ private:
+  typedef EpochReclaimer<Node> Reclaimer;
+
+  // most levels a node can have, enough for lists of millions
+  static const int kMaxLevel = 24;
+
+  // inserts minus removes by the threads of one of the reclaimer's slots
+  struct alignas(64) LengthSlot {
+    std::atomic<int> count;
+  };
+
+  // fills preds[i] with the last node before value on level i and succs[i]
+  // with the one after it, for every level in use. returns the highest
+  // level the node holding value was found on, -1 if none
+  int findPredecessors(const T& value, Node** preds, Node** succs) const;
+
+  // draws the level of a new node from the calling thread's generator
+  static int randomLevel();
+
+  // unlocks the distinct nodes among preds[0] to preds[highest_locked]
+  static void unlockPredecessors(Node** preds, int highest_locked);
+
+  // deletes the nodes linked through next_retired from node on
+  static void destroyRetired(Node* node);
+
+  // comparison functor used to define the order of the skip list
+  CompareFunc comp;
+
+  Node* head;
+  // levels that may be in use, only ever grows
+  std::atomic<int> m_level;
+  LengthSlot m_lengths[Reclaimer::kThreadSlots];
+  mutable Reclaimer m_reclaimer;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// DEFINITIONS
+///////////////////////////////////////////////////////////////////////////////
+
+template<class T>
+template<class... Args>
+ConcurrentSkipListNode<T>* ConcurrentSkipListNode<T>::create(int level,
+                                                             Args&&... args) {
+  typedef std::atomic<ConcurrentSkipListNode*> Link;
+  void* memory = ::operator new(towerOffset() + level * sizeof(Link),
+                                std::align_val_t(alignof(ConcurrentSkipListNode)));
+  ConcurrentSkipListNode* node;
+  try {
+    node = new (memory) ConcurrentSkipListNode(level, std::forward<Args>(args)...);
+  } catch (...) {
+    ::operator delete(memory, std::align_val_t(alignof(ConcurrentSkipListNode)));
+    throw;
+  }
+  for (int i = 0; i < level; i++) new (node->tower() + i) Link(nullptr);
+  return node;
+}
+
+template<class T>
+void ConcurrentSkipListNode<T>::destroy(ConcurrentSkipListNode* node) {
+  node->~ConcurrentSkipListNode();
+  ::operator delete(node, std::align_val_t(alignof(ConcurrentSkipListNode)));
+}
+
+template<class T>
+void ConcurrentSkipListNode<T>::lock() {
+  while (locked.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
+}
+
+// the list runs from head to a null link
+template<class T, class CompareFunc>
+ConcurrentSkipList<T, CompareFunc>::ConcurrentSkipList() : m_level(1) {
+  head = Node::create(kMaxLevel);
+  head->fully_linked.store(true);
+  for (LengthSlot& slot : m_lengths) slot.count.store(0);
+}
+
+template<class T, class CompareFunc>
+ConcurrentSkipList<T, CompareFunc>::~ConcurrentSkipList() {
+  Node* current = head;
+  while (current != nullptr) {
+    Node* next = current->next(0).load();
+    Node::destroy(current);
+    current = next;
+  }
+  destroyRetired(m_reclaimer.takeRetired());
+}
+
+template<class T, class CompareFunc>
+int ConcurrentSkipList<T, CompareFunc>::randomLevel() {
+  static std::atomic<unsigned int> next_seed(1);
+  thread_local std::minstd_rand generator(next_seed.fetch_add(1));
+  int node_level = 1;
+  for (unsigned int bits = generator(); (bits & 1) && node_level < kMaxLevel;
+       bits >>= 1) {
+    node_level++;
+  }
+  return node_level;
+}
+
+template<class T, class CompareFunc>
+int ConcurrentSkipList<T, CompareFunc>::findPredecessors(const T& value,
+                                                         Node** preds,
+                                                         Node** succs) const {
+  int found = -1;
+  Node* pred = head;
+  for (int i = m_level.load() - 1; i >= 0; i--) {
+    Node* current = pred->next(i).load();
+    while (current != nullptr && comp(current->data, value)) {
+      pred = current;
+      current = pred->next(i).load();
+    }
+    if (found == -1 && current != nullptr && !comp(value, current->data))
+      found = i;
+    preds[i] = pred;
+    succs[i] = current;
+  }
+  return found;
+}
+
+template<class T, class CompareFunc>
+void ConcurrentSkipList<T, CompareFunc>::unlockPredecessors(Node** preds,
+                                                            int highest_locked) {
+  Node* previous = nullptr;
+  for (int i = 0; i <= highest_locked; i++) {
+    if (preds[i] != previous) preds[i]->unlock();
+    previous = preds[i];
+  }
+}
+
+// predecessors are locked from level 0 up, so threads lock nodes from the
+// right to the left and can't deadlock
+template<class T, class CompareFunc>
+bool ConcurrentSkipList<T, CompareFunc>::insert(const T& value) {
+  typename Reclaimer::Guard guard(m_reclaimer);
+  int node_level = randomLevel();
+  for (int level = m_level.load(); level < node_level;)
+    m_level.compare_exchange_weak(level, node_level);
+
+  Node* preds[kMaxLevel];
+  Node* succs[kMaxLevel];
+  while (true) {
+    int found = findPredecessors(value, preds, succs);
+    if (found != -1) {
+      Node* node_found = succs[found];
+      if (!node_found->marked.load()) {
+        while (!node_found->fully_linked.load()) std::this_thread::yield();
+        return false;
+      }
+      // it's being removed, try again once it's gone
+      continue;
+    }
+
+    int highest_locked = -1;
+    bool valid = true;
+    Node* previous = nullptr;
+    for (int i = 0; valid && i < node_level; i++) {
+      if (preds[i] != previous) {
+        preds[i]->lock();
+        previous = preds[i];
+      }
+      highest_locked = i;
+      valid = !preds[i]->marked.load() &&
+              (succs[i] == nullptr || !succs[i]->marked.load()) &&
+              preds[i]->next(i).load() == succs[i];
+    }
+    if (!valid) {
+      unlockPredecessors(preds, highest_locked);
+      continue;
+    }
+
+    Node* node = Node::create(node_level, value);
+    for (int i = 0; i < node_level; i++) node->next(i).store(succs[i]);
+    for (int i = 0; i < node_level; i++) preds[i]->next(i).store(node);
+    node->fully_linked.store(true);
+    unlockPredecessors(preds, highest_locked);
+    m_lengths[Reclaimer::threadSlot()].count.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+}
+
+template<class T, class CompareFunc>
+bool ConcurrentSkipList<T, CompareFunc>::remove(const T& value) {
+  typename Reclaimer::Guard guard(m_reclaimer);
+  Node* preds[kMaxLevel];
+  Node* succs[kMaxLevel];
+  Node* victim = nullptr;
+  bool is_marked = false;
+  while (true) {
+    int found = findPredecessors(value, preds, succs);
+    if (!is_marked) {
+      if (found == -1) return false;
+      victim = succs[found];
+      // only a node that's fully linked, and found on its top level, has
+      // every predecessor in preds
+      if (!victim->fully_linked.load() || victim->level - 1 != found ||
+          victim->marked.load()) {
+        return false;
+      }
+      victim->lock();
+      if (victim->marked.load()) {
+        victim->unlock();
+        return false;
+      }
+      victim->marked.store(true);
+      is_marked = true;
+    }
+
+    int highest_locked = -1;
+    bool valid = true;
+    Node* previous = nullptr;
+    for (int i = 0; valid && i < victim->level; i++) {
+      if (preds[i] != previous) {
+        preds[i]->lock();
+        previous = preds[i];
+      }
+      highest_locked = i;
+      valid = !preds[i]->marked.load() && preds[i]->next(i).load() == victim;
+    }
+    if (!valid) {
+      unlockPredecessors(preds, highest_locked);
+      continue;
+    }
+
+    for (int i = victim->level - 1; i >= 0; i--)
+      preds[i]->next(i).store(victim->next(i).load());
+    victim->unlock();
+    unlockPredecessors(preds, highest_locked);
+    m_lengths[Reclaimer::threadSlot()].count.fetch_sub(1, std::memory_order_relaxed);
+    destroyRetired(m_reclaimer.retire(victim, guard));
+    return true;
+  }
+}
+
+template<class T, class CompareFunc>
+bool ConcurrentSkipList<T, CompareFunc>::contains(const T& value) const {
+  typename Reclaimer::Guard guard(m_reclaimer);
+  Node* preds[kMaxLevel];
+  Node* succs[kMaxLevel];
+  int found = findPredecessors(value, preds, succs);
+  return found != -1 && succs[found]->fully_linked.load() &&
+         !succs[found]->marked.load();
+}
+
+template<class T, class CompareFunc>
+int ConcurrentSkipList<T, CompareFunc>::getLength() const {
+  int length = 0;
+  for (const LengthSlot& slot : m_lengths)
+    length += slot.count.load(std::memory_order_relaxed);
+  return length;
+}
+
+template<class T, class CompareFunc>
+void ConcurrentSkipList<T, CompareFunc>::destroyRetired(Node* node) {
+  while (node != nullptr) {
+    Node* next = node->next_retired;
+    Node::destroy(node);
+    node = next;
+  }
+}
+
+#endif  // CONCURRENTSKIPLIST_H_
@@ -0,0 +1,87 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+
+#ifndef CORPUSREADER_H_
+#define CORPUSREADER_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mappedfile.h"
+
+class TokenPipeline;
+
+// Splits a text file into words for the tries. Words are separated by
+// whitespace, punctuation other than periods is dropped and letters are
+// lower cased, using a table lookup per character. The file is memory
+// mapped and words are handed out in batches as string_views: words that
+// are already clean point into the mapping, the rest are cleaned into a
+// buffer owned by the reader, so no word is allocated on its own.
+class CorpusReader {
+ public:
+  // roughly how much of the text each batch covers
+  static const std::size_t kBatchBytes = 1 << 16;
+
+  explicit CorpusReader(const std::string &file_name);
+
+  CorpusReader(const CorpusReader &) = delete;
+  CorpusReader &operator=(const CorpusReader &) = delete;
+
+  // false if the file couldn't be opened
+  bool isOpen() const { return m_file.isOpen(); }
+
+  // the whole text as mapped, for callers that split it up themselves
+  std::string_view getText() const {
+    return std::string_view(m_file.data(), m_file.size());
+  }
+
+  // replaces words with the next batch of words, run through pipeline if
+  // one is given. returns false once the text is used up. The views are
+  // valid until the next call
+  bool nextBatch(std::vector<std::string_view>* words,
+                 const TokenPipeline* pipeline = nullptr);
+
+  // appends the words of text to words. Words needing cleaning are written
+  // to buffer, which is cleared and must not change until the views are
+  // no longer used. With split_sentences an empty view is appended after
+  // each word ending a sentence (with '.', '!' or '?', possibly followed by
+  // closing quotes or brackets), at blank lines and at rules such as
+  // "-----", and periods ending a sentence are removed from its last word
+  static void tokenize(std::string_view text, std::vector<std::string_view>* words,
+                       std::string* buffer, bool split_sentences = false);
+
+  // cleans a single word in place
+  static void cleanWord(std::string* word);
+
+ private:
+  MappedFile m_file;
+  std::size_t m_position;
+  std::string m_buffer;
+};
+
+#endif  // CORPUSREADER_H_
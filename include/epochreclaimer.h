@@ -0,0 +1,181 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+
+#ifndef EPOCHRECLAIMER_H_
+#define EPOCHRECLAIMER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+// Epoch based reclamation for the nodes of lock-free containers. A node
+// unlinked from a container can still be read by threads that reached it
+// before, so it can't be freed straight away. Threads hold a Guard while
+// they use the container, counting them in under the global epoch on a
+// counter shared with few other threads. Unlinked nodes are retired with
+// the epoch they were retired in and handed back to the container once
+// the epoch has moved two further, which can only happen after every
+// guard taken before the node was unlinked has been released.
+//
+// Node needs a Node* next_retired member, the reclaimer links retired
+// nodes through it.
+template<class Node>
+class EpochReclaimer {
+ public:
+  // threads hash to one of these, so they rarely share a counter
+  static const int kThreadSlots = 32;
+
+ private:
+  struct alignas(64) Slot {
+    // threads holding a guard, by the epoch they entered in modulo 3
+    std::atomic<int> active[3];
+    // approximate number of retires, threads sharing the slot may miss
+    // each other's
+    std::atomic<int> retired;
+  };
+
+ public:
+  // counts the calling thread in for the current epoch while alive
+  class Guard {
+   public:
+    explicit Guard(const EpochReclaimer& reclaimer);
+    ~Guard() { m_active->fetch_sub(1); }
+
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+   private:
+    friend class EpochReclaimer;
+    Slot* m_slot;
+    std::atomic<int>* m_active;
+  };
+
+  EpochReclaimer();
+
+  EpochReclaimer(const EpochReclaimer&) = delete;
+  EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+  // the slot of the calling thread, between 0 and kThreadSlots. containers
+  // can use it to spread their own per thread state
+  static int threadSlot();
+
+  // hands over node, which the caller unlinked while holding guard.
+  // returns nodes no guard can see any more, linked through next_retired,
+  // for the caller to free or reuse, or nullptr
+  Node* retire(Node* node, const Guard& guard);
+
+  // takes every node retired so far. only for when no thread holds a guard,
+  // as the container is being destroyed
+  Node* takeRetired();
+
+ private:
+  // retires by a slot between attempts to move the epoch on
+  static const int kAdvanceInterval = 64;
+
+  // moves the epoch on if no guard is left in the one before, returning
+  // the nodes retired two epochs ago. returns nullptr at once if another
+  // thread is at it
+  Node* tryAdvance();
+
+  alignas(64) std::atomic<std::uint64_t> m_epoch;
+  // nodes retired in each epoch modulo 3, as stacks through next_retired
+  std::atomic<Node*> m_retired[3];
+  std::mutex m_advance_mutex;
+  mutable Slot m_slots[kThreadSlots];
+};
+
+template<class Node>
+EpochReclaimer<Node>::EpochReclaimer() : m_epoch(0) {
+  for (std::atomic<Node*>& retired : m_retired) retired.store(nullptr);
+  for (Slot& slot : m_slots) {
+    for (std::atomic<int>& active : slot.active) active.store(0);
+    slot.retired.store(0);
+  }
+}
+
+// spreads threads over the slots
+template<class Node>
+int EpochReclaimer<Node>::threadSlot() {
+  static std::atomic<int> next_slot(0);
+  thread_local int slot = next_slot.fetch_add(1) % kThreadSlots;
+  return slot;
+}
+
+// the epoch is read again after counting in, so a thread held up between
+// the two never counts itself into an epoch that's already been left
+template<class Node>
+EpochReclaimer<Node>::Guard::Guard(const EpochReclaimer& reclaimer)
+    : m_slot(&reclaimer.m_slots[threadSlot()]) {
+  while (true) {
+    std::uint64_t epoch = reclaimer.m_epoch.load();
+    m_active = &m_slot->active[epoch % 3];
+    m_active->fetch_add(1);
+    if (reclaimer.m_epoch.load() == epoch) return;
+    m_active->fetch_sub(1);
+  }
+}
+
+template<class Node>
+Node* EpochReclaimer<Node>::retire(Node* node, const Guard& guard) {
+  std::atomic<Node*>& retired = m_retired[m_epoch.load() % 3];
+  node->next_retired = retired.load();
+  while (!retired.compare_exchange_weak(node->next_retired, node)) {}
+  int count = guard.m_slot->retired.load(std::memory_order_relaxed) + 1;
+  guard.m_slot->retired.store(count, std::memory_order_relaxed);
+  return count % kAdvanceInterval == 0 ? tryAdvance() : nullptr;
+}
+
+// a guard counted in epoch - 1 may see nodes retired in epoch - 1, so the
+// epoch moves on only once there are none. nodes retired in an epoch are
+// then handed back when it moves on the second time, at which point every
+// guard that could have seen them is gone. as a retiring thread holds a
+// guard itself, nothing gets added to a list while it's handed back
+template<class Node>
+Node* EpochReclaimer<Node>::tryAdvance() {
+  std::unique_lock<std::mutex> lock(m_advance_mutex, std::try_to_lock);
+  if (!lock.owns_lock()) return nullptr;
+  std::uint64_t epoch = m_epoch.load();
+  for (const Slot& slot : m_slots)
+    if (slot.active[(epoch + 2) % 3].load() != 0) return nullptr;
+  m_epoch.store(epoch + 1);
+  return m_retired[(epoch + 2) % 3].exchange(nullptr);
+}
+
+template<class Node>
+Node* EpochReclaimer<Node>::takeRetired() {
+  Node* all = nullptr;
+  for (std::atomic<Node*>& retired : m_retired) {
+    Node* first = retired.exchange(nullptr);
+    if (first == nullptr) continue;
+    Node* last = first;
+    while (last->next_retired != nullptr) last = last->next_retired;
+    last->next_retired = all;
+    all = first;
+  }
+  return all;
+}
+
+#endif  // EPOCHRECLAIMER_H_
@@ -0,0 +1,310 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+
+#ifndef INTRUSIVELIST_H_
+#define INTRUSIVELIST_H_
+
+#include <cstddef>
+#include <iostream>
+#include <iterator>
+#include <type_traits>
+
+// links of an element on an IntrusiveList, inherited by the element's type.
+// a type derives from one per list it can be on at the same time, each with
+// its own Tag
+template<class Tag = void>
+struct IntrusiveListHook {
+  IntrusiveListHook* next;
+  IntrusiveListHook* prev;
+
+  IntrusiveListHook() : next(nullptr), prev(nullptr) {}
+  // copies of an element start out on no list
+  IntrusiveListHook(const IntrusiveListHook&) : next(nullptr), prev(nullptr) {}
+  IntrusiveListHook& operator=(const IntrusiveListHook&) { return *this; }
+
+  // true while the element is on a list through this hook
+  bool isLinked() const { return next != nullptr; }
+};
+
+// Doubly linked list of elements it doesn't own, threaded through the
+// IntrusiveListHook<Tag> base of T. Like LinkedList it runs between a
+// head and a tail sentinel, but those are hooks inside the list and the
+// elements are linked in place, so inserting never allocates, an element
+// keeps its identity and can be removed in constant time given just a
+// reference to it. Elements have to stay alive while they're on the list,
+// and a hook is on at most one list at a time.
+template<class T, class Tag = void>
+class IntrusiveList {
+  typedef IntrusiveListHook<Tag> Hook;
+  static_assert(std::is_base_of<Hook, T>::value,
+                "T must derive from IntrusiveListHook<Tag>");
+
+ public:
+  // bidirectional iterator over the list's elements, Value is T or const T
+  template<class Value>
+  class Iterator {
+   public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Value* pointer;
+    typedef Value& reference;
+
+    Iterator() : m_hook(nullptr) {}
+    // iterators convert to const iterators
+    template<class Other, class = typename std::enable_if<
+        std::is_same<Value, const Other>::value>::type>
+    Iterator(const Iterator<Other>& other) : m_hook(other.m_hook) {}
+
+    reference operator*() const { return *owner(m_hook); }
+    pointer operator->() const { return owner(m_hook); }
+    Iterator& operator++() { m_hook = m_hook->next; return *this; }
+    Iterator operator++(int) { Iterator temp(*this); ++*this; return temp; }
+    Iterator& operator--() { m_hook = m_hook->prev; return *this; }
+    Iterator operator--(int) { Iterator temp(*this); --*this; return temp; }
+    bool operator==(const Iterator& other) const { return m_hook == other.m_hook; }
+    bool operator!=(const Iterator& other) const { return m_hook != other.m_hook; }
+
+   private:
+    friend class IntrusiveList;
+    template<class> friend class Iterator;
+    explicit Iterator(Hook* hook) : m_hook(hook) {}
+
+    Hook* m_hook;
+  };
+
+  typedef Iterator<T> iterator;
+  typedef Iterator<const T> const_iterator;
+
+  // creates an empty list
+  IntrusiveList();
+  // takes over other_list's elements, other_list is left empty
+  IntrusiveList(IntrusiveList&& other_list);
+  // unlinks every element
+  ~IntrusiveList();
+
+  IntrusiveList(const IntrusiveList&) = delete;
+  IntrusiveList& operator=(const IntrusiveList&) = delete;
+
+  // links element in at the start or end of the list
+  void insertStart(T& element);
+  void insertEnd(T& element);
+  // links element in before position, returns its iterator
+  iterator insert(const_iterator position, T& element);
+
+  // unlinks element, which must be on this list, in constant time
+  void remove(T& element);
+  // unlinks the element at position, returns the iterator after it
+  iterator erase(const_iterator position);
+  // unlinks and returns the first or last element, nullptr if the list is
+  // empty
+  T* removeFirst();
+  T* removeLast();
+
+  // moves every element of other_list before position, in constant time
+  void splice(const_iterator position, IntrusiveList& other_list);
+  // moves element, which is on other_list, before position. other_list
+  // may be this list, as when moving an element to the end of an LRU list
+  void splice(const_iterator position, IntrusiveList& other_list, T& element);
+
+  // unlinks every element
+  void clear();
+
+  iterator begin() { return iterator(head.next); }
+  iterator end() { return iterator(&tail); }
+  const_iterator begin() const { return const_iterator(head.next); }
+  const_iterator end() const { return const_iterator(const_cast<Hook*>(&tail)); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  // returns the iterator at element, which must be on this list
+  iterator iteratorTo(T& element) { return iterator(hookOf(element)); }
+
+  // returns first or last element in the list, nullptr if it's empty
+  T* getFirst() const;
+  T* getLast() const;
+
+  // returns number of elements in list
+  int getLength() const { return length; }
+
+  // prints list in order in the form,
+  // "Head -> data -> data -> data...."
+  void print() const;
+
+ private:
+  // returns the element hook is the base of, or element's hook
+  static T* owner(Hook* hook) { return static_cast<T*>(hook); }
+  static Hook* hookOf(T& element) { return &static_cast<Hook&>(element); }
+
+  // links hook in before position
+  void linkBefore(Hook* position, Hook* hook);
+  // unlinks hook from the list, leaving it marked as on no list
+  void unlink(Hook* hook);
+
+  Hook head;
+  Hook tail;
+  int length;
+};
+
+template<class T, class Tag>
+IntrusiveList<T, Tag>::IntrusiveList() : length(0) {
+  head.next = &tail;
+  tail.prev = &head;
+}
+
+template<class T, class Tag>
+IntrusiveList<T, Tag>::IntrusiveList(IntrusiveList&& other_list) : IntrusiveList() {
+  splice(end(), other_list);
+}
+
+template<class T, class Tag>
+IntrusiveList<T, Tag>::~IntrusiveList() {
+  clear();
+}
+
+template<class T, class Tag>
+void IntrusiveList<T, Tag>::linkBefore(Hook* position, Hook* hook) {
+  hook->prev = position->prev;
+  hook->next = position;
+  position->prev->next = hook;
+  position->prev = hook;
+  length++;
+}
+
+template<class T, class Tag>
+void IntrusiveList<T, Tag>::unlink(Hook* hook) {
+  hook->prev->next = hook->next;
+  hook->next->prev = hook->prev;
+  hook->next = nullptr;
+  hook->prev = nullptr;
+  length--;
+}
+
+template<class T, class Tag>
+void IntrusiveList<T, Tag>::insertStart(T& element) {
+  linkBefore(head.next, hookOf(element));
+}
+
+template<class T, class Tag>
+void IntrusiveList<T, Tag>::insertEnd(T& element) {
+  linkBefore(&tail, hookOf(element));
+}
+
+template<class T, class Tag>
+typename IntrusiveList<T, Tag>::iterator IntrusiveList<T, Tag>::insert(
+    const_iterator position, T& element) {
+  linkBefore(position.m_hook, hookOf(element));
+  return iterator(hookOf(element));
+}
+
+template<class T, class Tag>
+void IntrusiveList<T, Tag>::remove(T& element) {
+  unlink(hookOf(element));
+}
+
+template<class T, class Tag>
+typename IntrusiveList<T, Tag>::iterator IntrusiveList<T, Tag>::erase(
+    const_iterator position) {
+  Hook* next = position.m_hook->next;
+  unlink(position.m_hook);
+  return iterator(next);
+}
+
+template<class T, class Tag>
+T* IntrusiveList<T, Tag>::removeFirst() {
+  if (length == 0) return nullptr;
+  Hook* first = head.next;
+  unlink(first);
+  return owner(first);
+}
+
+template<class T, class Tag>
+T* IntrusiveList<T, Tag>::removeLast() {
+  if (length == 0) return nullptr;
+  Hook* last = tail.prev;
+  unlink(last);
+  return owner(last);
+}
+
+template<class T, class Tag>
+void IntrusiveList<T, Tag>::splice(const_iterator position, IntrusiveList& other_list) {
+  if (&other_list == this || other_list.length == 0) return;
+  Hook* first = other_list.head.next;
+  Hook* last = other_list.tail.prev;
+  other_list.head.next = &other_list.tail;
+  other_list.tail.prev = &other_list.head;
+
+  first->prev = position.m_hook->prev;
+  last->next = position.m_hook;
+  position.m_hook->prev->next = first;
+  position.m_hook->prev = last;
+  length += other_list.length;
+  other_list.length = 0;
+}
+
+template<class T, class Tag>
+void IntrusiveList<T, Tag>::splice(const_iterator position, IntrusiveList& other_list,
+                                  T& element) {
+  Hook* hook = hookOf(element);
+  if (hook == position.m_hook || hook->next == position.m_hook) return;
+  other_list.unlink(hook);
+  linkBefore(position.m_hook, hook);
+}
+
+template<class T, class Tag>
+void IntrusiveList<T, Tag>::clear() {
+  Hook* current = head.next;
+  while (current != &tail) {
+    Hook* next = current->next;
+    current->next = nullptr;
+    current->prev = nullptr;
+    current = next;
+  }
+  head.next = &tail;
+  tail.prev = &head;
+  length = 0;
+}
+
+template<class T, class Tag>
+T* IntrusiveList<T, Tag>::getFirst() const {
+  return length == 0 ? nullptr : owner(head.next);
+}
+
+template<class T, class Tag>
+T* IntrusiveList<T, Tag>::getLast() const {
+  return length == 0 ? nullptr : owner(tail.prev);
+}
+
+// prints list in order in the form,
+// "Head -> data -> data -> data...."
+template<class T, class Tag>
+void IntrusiveList<T, Tag>::print() const {
+  std::cout << "Head";
+  for (const T& element : *this) std::cout << " -> " << element;
+  std::cout << std::endl;
+}
+
+#endif  // INTRUSIVELIST_H_
@@ -27,7 +27,18 @@
 #ifndef LINKEDLIST_H_
 #define LINKEDLIST_H_
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 ///////////////////////////////////////////////////////////////////////////////
 // DECLARATIONS
@@ -40,44 +51,211 @@ struct ListNode {
   ListNode<T>* prev;
   // creates empty list node
   ListNode();
-  // creates list node containing value
+  // creates list node containing a copy of value
   explicit ListNode(const T& value);
+  // creates list node value is moved into
+  explicit ListNode(T&& value);
+  // creates list node with data constructed from args
+  template<class... Args>
+  explicit ListNode(std::in_place_t, Args&&... args);
 };
 
+// LinkedList membership policy that keeps no index, so contains and
+// remove by value scan the list
 template<class T>
+struct ScannedMembership {
+  static constexpr bool kIndexed = false;
+  void add(ListNode<T>*) {}
+  void remove(ListNode<T>*) {}
+  void clear() {}
+  ListNode<T>* find(const T&) const { return nullptr; }
+};
+
+// LinkedList membership policy that keeps a hash set of the list's nodes,
+// making contains and remove by value constant time on average at the
+// cost of a hash on every insert and a 16 byte slot per node, with at
+// least a quarter of the slots left empty. The set is open addressed with
+// linear probing and keeps each node's hash, so growing the table and
+// closing gaps never rehash. remove hashes the node's data to find its
+// slot, so a node has to be removed while it still holds its value
+template<class T, class Hash = std::hash<T>>
+class HashedMembership {
+ public:
+  static constexpr bool kIndexed = true;
+
+  HashedMembership() : m_count(0) {}
+
+  // adds node, which may hold a value equal to another node's
+  void add(ListNode<T>* node);
+  // removes node, which must have been added
+  void remove(ListNode<T>* node);
+  void clear();
+  // returns a node holding value, nullptr if none
+  ListNode<T>* find(const T& value) const;
+
+ private:
+  struct Slot {
+    ListNode<T>* node;
+    std::size_t hash;
+  };
+
+  // Hash with its bits mixed, as hashes like std::hash<int> would
+  // otherwise pile consecutive values into one run of slots
+  std::size_t hash(const T& value) const;
+  // doubles the table, keeping it at most three quarters full
+  void grow();
+  void place(const Slot& slot);
+
+  // power of two sized, empty slots have a null node
+  std::vector<Slot> m_slots;
+  std::size_t m_count;
+  Hash m_hash;
+};
+
+// Doubly linked list with sentinel head and tail nodes. Nodes come from
+// Allocator, and erased nodes are kept on a free list owned by the list and
+// reused by later inserts, so a list used as a queue stops allocating once
+// it has reached its largest size. Lists splicing nodes between each other
+// must have equal allocators.
+//
+// Membership decides how contains and remove by value find an element.
+// The default, ScannedMembership, walks the list and costs nothing
+// otherwise. HashedMembership indexes every node, see HashedLinkedList.
+// An indexed list only gives const access to its elements, as changing
+// one in place would leave the index stale.
+//
+// Positional access walks from the nearest of the two ends and a set of
+// checkpoints, every stride-th node with stride about sqrt(length), so
+// getItemAt, insertAt and removeAt take O(sqrt n) steps once the
+// checkpoints are in place. insertAt and removeAt keep them up to date,
+// while operations that don't know an index (iterator inserts and erases,
+// splice, sort) and inserts or removals at the start drop them, to be
+// rebuilt by the next positional access. Since getItemAt updates the
+// checkpoints, concurrent readers of one list need to be synchronized.
+template<class T, class Allocator = std::allocator<T>,
+         class Membership = ScannedMembership<T>>
 class LinkedList {
  public:
+  // bidirectional iterator over the list's elements, Value is T or const T
+  template<class Value>
+  class Iterator {
+   public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Value* pointer;
+    typedef Value& reference;
+
+    Iterator() : m_node(nullptr) {}
+    // iterators convert to const iterators
+    template<class Other, class = typename std::enable_if<
+        std::is_same<Value, const Other>::value>::type>
+    Iterator(const Iterator<Other>& other) : m_node(other.m_node) {}
+
+    reference operator*() const { return m_node->data; }
+    pointer operator->() const { return &m_node->data; }
+    Iterator& operator++() { m_node = m_node->next; return *this; }
+    Iterator operator++(int) { Iterator temp(*this); ++*this; return temp; }
+    Iterator& operator--() { m_node = m_node->prev; return *this; }
+    Iterator operator--(int) { Iterator temp(*this); --*this; return temp; }
+    bool operator==(const Iterator& other) const { return m_node == other.m_node; }
+    bool operator!=(const Iterator& other) const { return m_node != other.m_node; }
+
+   private:
+    friend class LinkedList;
+    template<class> friend class Iterator;
+    explicit Iterator(ListNode<T>* node) : m_node(node) {}
+
+    ListNode<T>* m_node;
+  };
+
+  typedef Iterator<typename std::conditional<
+      Membership::kIndexed, const T, T>::type> iterator;
+  typedef Iterator<const T> const_iterator;
+  // element reference handed out by iterators and emplace, const when
+  // Membership indexes the elements
+  typedef typename iterator::reference reference;
+
   // default constructor
-  LinkedList();
+  explicit LinkedList(const Allocator& allocator = Allocator());
   // copy constructor
-  explicit LinkedList(const LinkedList& other_list);
+  LinkedList(const LinkedList& other_list);
+  // move constructor, other_list is left empty
+  LinkedList(LinkedList&& other_list);
   // destructor
   ~LinkedList();
   // assignment operator
   LinkedList& operator=(const LinkedList& other_list);
+  // move assignment operator, other_list is left empty
+  LinkedList& operator=(LinkedList&& other_list);
 
   // insert value at start of list
   void insertStart(const T& value);
+  void insertStart(T&& value);
   // insert value at end of list
   void insertEnd(const T& value);
+  void insertEnd(T&& value);
   // insert value at specified index
   void insertAt(const T& value, const int index);
+  void insertAt(T&& value, const int index);
+
+  // construct an element from args at the start or end of the list
+  template<class... Args>
+  reference emplaceStart(Args&&... args);
+  template<class... Args>
+  reference emplaceEnd(Args&&... args);
+
+  // constructs an element from args before position, returns its iterator
+  template<class... Args>
+  iterator emplace(const_iterator position, Args&&... args);
+  // inserts value before position, returns its iterator
+  iterator insert(const_iterator position, const T& value);
+  iterator insert(const_iterator position, T&& value);
+  // removes the element at position, returns the iterator after it
+  iterator erase(const_iterator position);
+
+  // moves every element of other_list before position, in constant time
+  void splice(const_iterator position, LinkedList& other_list);
+  // moves the element at element from other_list before position
+  void splice(const_iterator position, LinkedList& other_list,
+              const_iterator element);
+
+  // stable merge sort that relinks nodes, no element is copied or moved
+  template<class Compare = std::less<T>>
+  void sort(Compare compare = Compare());
+
+  // removes every element, keeping their nodes for reuse
+  void clear();
+
+  // makes sure count elements can be inserted without allocating
+  void reserve(int count);
+  // releases the nodes kept for reuse
+  void releaseFreeNodes();
+
+  iterator begin() { return iterator(head->next); }
+  iterator end() { return iterator(tail); }
+  const_iterator begin() const { return const_iterator(head->next); }
+  const_iterator end() const { return const_iterator(tail); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
 
   // returns true if value is in list
   bool contains(const T& value) const;
+  // removes an element equal to value, returns false if there is none
+  bool remove(const T& value);
 
   // returns first element in the list
-  inline T getFirst() const;
+  inline const T& getFirst() const;
   // returns last element in the list
-  inline T getLast() const;
+  inline const T& getLast() const;
   // returns element at specified index
-  T getItemAt(const int index) const;
+  const T& getItemAt(const int index) const;
 
-  // removes first element from the list
+  // removes first element from the list, moving it out
   T removeFirst();
-  // removes last element from the list
+  // removes last element from the list, moving it out
   T removeLast();
-  // removes element at specified index
+  // removes element at specified index, moving it out
   T removeAt(const int index);
 
   //returns number of elements in list
@@ -88,11 +266,65 @@ class LinkedList {
   void print() const;
 
  private:
+  typedef typename std::allocator_traits<Allocator>::template
+      rebind_alloc<ListNode<T>> NodeAllocator;
+  typedef std::allocator_traits<NodeAllocator> NodeTraits;
+
+  // what an unused node's memory holds while on the free list
+  struct FreeNode {
+    FreeNode* next;
+  };
+
+  // constructs a node from args in a free node, or new memory if there
+  // is none
+  template<class... Args>
+  ListNode<T>* createNode(Args&&... args);
+  // destroys node and puts its memory on the free list
+  void destroyNode(ListNode<T>* node);
+  // creates the sentinels of an empty list
+  void initialize();
+  // returns the node at index, which must be in the list, walking from the
+  // nearest end or checkpoint
+  ListNode<T>* nodeAt(int index) const;
+  // moves the checkpoints at or after index after a node was inserted at
+  // index (shift 1), or before the node at index is removed (shift -1)
+  void shiftCheckpoints(int index, int shift);
+  // drops the checkpoints after a change that moved nodes of unknown index
+  void resetCheckpoints() { checkpoints.clear(); }
+
+  // links node in before position
+  void linkBefore(ListNode<T>* position, ListNode<T>* node);
+  // unlinks node from the list without deleting it. node->data must be
+  // intact, the membership index looks the node up by it
+  void unlink(ListNode<T>* node);
+
+  // merges the null terminated sorted runs first and second, elements of
+  // first going before equal ones of second
+  template<class Compare>
+  static ListNode<T>* mergeRuns(ListNode<T>* first, ListNode<T>* second,
+                                Compare& compare);
+
+  NodeAllocator node_allocator;
   ListNode<T>* head;
   ListNode<T>* tail;
   int length;
+  FreeNode* free_nodes;
+  int free_count;
+  Membership membership;
+
+  // walks shorter than this go straight from an end
+  static constexpr int kMinStride = 16;
+  // checkpoints[c] is the node at index c * stride. They cover a prefix of
+  // the list that nodeAt extends whenever it walks past the last one
+  mutable std::vector<ListNode<T>*> checkpoints;
+  mutable int stride;
 };
 
+// list whose contains and remove by value take constant time on average,
+// for lists that are checked for an element before every insert
+template<class T, class Hash = std::hash<T>>
+using HashedLinkedList = LinkedList<T, std::allocator<T>, HashedMembership<T, Hash>>;
+
 ///////////////////////////////////////////////////////////////////////////////
 // DEFINITIONS
 ///////////////////////////////////////////////////////////////////////////////
@@ -105,157 +337,478 @@ ListNode<T>::ListNode() {
 
 // initializes ListNode
 template<class T>
-ListNode<T>::ListNode(const T& value) {
-  data = value;
+ListNode<T>::ListNode(const T& value) : data(value) {
   next = nullptr;
   prev = nullptr;
 }
 
-// initializes empty LinkedList
+// initializes ListNode by moving value in
 template<class T>
-LinkedList<T>::LinkedList() {
-  head = new ListNode<T>();
-  tail = new ListNode<T>();
+ListNode<T>::ListNode(T&& value) : data(std::move(value)) {
+  next = nullptr;
+  prev = nullptr;
+}
+
+// initializes ListNode with data constructed in place
+template<class T>
+template<class... Args>
+ListNode<T>::ListNode(std::in_place_t, Args&&... args)
+    : data(std::forward<Args>(args)...) {
+  next = nullptr;
+  prev = nullptr;
+}
+
+// initializes empty LinkedList
+template<class T, class Allocator, class Membership>
+LinkedList<T, Allocator, Membership>::LinkedList(const Allocator& allocator)
+    : node_allocator(allocator) {
+  initialize();
+}
+
+// copy constructor
+// initializes new LinkedList as a deep copy of existing LinkedList
+template<class T, class Allocator, class Membership>
+LinkedList<T, Allocator, Membership>::LinkedList(const LinkedList& other_list)
+    : node_allocator(NodeTraits::select_on_container_copy_construction(
+          other_list.node_allocator)) {
+  initialize();
+  for (const T& value : other_list) insertEnd(value);
+}
+
+// takes over other_list's elements, other_list keeps its free nodes
+template<class T, class Allocator, class Membership>
+LinkedList<T, Allocator, Membership>::LinkedList(LinkedList&& other_list)
+    : node_allocator(other_list.node_allocator) {
+  initialize();
+  splice(end(), other_list);
+}
+
+template<class T, class Allocator, class Membership>
+void LinkedList<T, Allocator, Membership>::initialize() {
+  free_nodes = nullptr;
+  free_count = 0;
   length = 0;
+  stride = kMinStride;
+  head = createNode();
+  tail = createNode();
   head->next = tail;
   tail->prev = head;
 }
 
-// copy constructor
-// initializes new LinkedList as a deep copy of existing LinkedList
-template<class T>
-LinkedList<T>::LinkedList(const LinkedList& other_list) {
-  ListNode<T>* other_node = other_list.head->next;
-  ListNode<T>* current = head;
-  head = new ListNode<T>();
-  tail = new ListNode<T>();
-  current = current->next;
-  while (other_node != other_list.tail) {
-    current->next = new ListNode<T>(other_node->data);
-    current->next->prev = current;
-    current = current->next;
-    other_node = other_node->next;
+template<class T, class Allocator, class Membership>
+template<class... Args>
+ListNode<T>* LinkedList<T, Allocator, Membership>::createNode(Args&&... args) {
+  ListNode<T>* node;
+  if (free_nodes != nullptr) {
+    node = reinterpret_cast<ListNode<T>*>(free_nodes);
+    free_nodes = free_nodes->next;
+    free_count--;
+  } else {
+    node = NodeTraits::allocate(node_allocator, 1);
   }
-  current->next = tail;
-  tail->prev = current;
-  other_list.length;
+  NodeTraits::construct(node_allocator, node, std::forward<Args>(args)...);
+  return node;
 }
 
-// releases memory allocated by LinkedList
-template<class T>
-LinkedList<T>::~LinkedList() {
-  ListNode<T>* current = head->next;
-  while (current != tail) {
-    delete current->prev;
-    current = current->next;
+template<class T, class Allocator, class Membership>
+void LinkedList<T, Allocator, Membership>::destroyNode(ListNode<T>* node) {
+  NodeTraits::destroy(node_allocator, node);
+  free_nodes = new (static_cast<void*>(node)) FreeNode{free_nodes};
+  free_count++;
+}
+
+template<class T, class Allocator, class Membership>
+void LinkedList<T, Allocator, Membership>::reserve(int count) {
+  for (; free_count < count - length; free_count++) {
+    ListNode<T>* node = NodeTraits::allocate(node_allocator, 1);
+    free_nodes = new (static_cast<void*>(node)) FreeNode{free_nodes};
+  }
+}
+
+template<class T, class Allocator, class Membership>
+void LinkedList<T, Allocator, Membership>::releaseFreeNodes() {
+  while (free_nodes != nullptr) {
+    FreeNode* next = free_nodes->next;
+    NodeTraits::deallocate(node_allocator,
+                           reinterpret_cast<ListNode<T>*>(free_nodes), 1);
+    free_nodes = next;
+  }
+  free_count = 0;
+}
+
+// replaces the contents with a deep copy of other_list
+template<class T, class Allocator, class Membership>
+LinkedList<T, Allocator, Membership>&
+LinkedList<T, Allocator, Membership>::operator=(const LinkedList& other_list) {
+  if (this != &other_list) {
+    clear();
+    for (const T& value : other_list) insertEnd(value);
+  }
+  return *this;
+}
+
+// replaces the contents with other_list's elements
+template<class T, class Allocator, class Membership>
+LinkedList<T, Allocator, Membership>&
+LinkedList<T, Allocator, Membership>::operator=(LinkedList&& other_list) {
+  if (this != &other_list) {
+    clear();
+    if (node_allocator == other_list.node_allocator) {
+      splice(end(), other_list);
+    } else {
+      // walks the nodes, as an indexed list's iterators are const
+      for (ListNode<T>* node = other_list.head->next; node != other_list.tail;
+           node = node->next)
+        insertEnd(std::move(node->data));
+      other_list.clear();
+    }
   }
-  delete current->prev;
-  delete current;
+  return *this;
+}
+
+// releases memory allocated by LinkedList
+template<class T, class Allocator, class Membership>
+LinkedList<T, Allocator, Membership>::~LinkedList() {
+  clear();
+  NodeTraits::destroy(node_allocator, head);
+  NodeTraits::deallocate(node_allocator, head, 1);
+  NodeTraits::destroy(node_allocator, tail);
+  NodeTraits::deallocate(node_allocator, tail, 1);
+  releaseFreeNodes();
 }
 
 // insert item at start of list
-template<class T>
-void LinkedList<T>::insertStart(const T &value) {
-  ListNode<T>* temp = new ListNode<T>(value);
-  temp->next = head->next;
-  temp->next->prev = temp;
-  temp->prev = head;
-  head->next = temp;
-  length++;
+template<class T, class Allocator, class Membership>
+void LinkedList<T, Allocator, Membership>::insertStart(const T &value) {
+  resetCheckpoints();
+  linkBefore(head->next, createNode(value));
+}
+
+template<class T, class Allocator, class Membership>
+void LinkedList<T, Allocator, Membership>::insertStart(T &&value) {
+  resetCheckpoints();
+  linkBefore(head->next, createNode(std::move(value)));
 }
 
 // insert item at end of list
-template<class T>
-void LinkedList<T>::insertEnd(const T &value) {
-  ListNode<T>* temp = new ListNode<T>(value);
-  temp->prev = tail->prev;
-  temp->next = tail;
-  tail->prev->next = temp;
-  tail->prev = temp;
-  length++;
+template<class T, class Allocator, class Membership>
+void LinkedList<T, Allocator, Membership>::insertEnd(const T &value) {
+  linkBefore(tail, createNode(value));
+}
+
+template<class T, class Allocator, class Membership>
+void LinkedList<T, Allocator, Membership>::insertEnd(T &&value) {
+  linkBefore(tail, createNode(std::move(value)));
+}
+
+template<class T, class Allocator, class Membership>
+template<class... Args>
+typename LinkedList<T, Allocator, Membership>::reference
+LinkedList<T, Allocator, Membership>::emplaceStart(Args&&... args) {
+  return *emplace(begin(), std::forward<Args>(args)...);
+}
+
+template<class T, class Allocator, class Membership>
+template<class... Args>
+typename LinkedList<T, Allocator, Membership>::reference
+LinkedList<T, Allocator, Membership>::emplaceEnd(Args&&... args) {
+  return *emplace(end(), std::forward<Args>(args)...);
+}
+
+// returns the node at index, walking from whichever end or checkpoint is
+// nearest. Walks past the last checkpoint add checkpoints as they go
+template<class T, class Allocator, class Membership>
+ListNode<T>* LinkedList<T, Allocator, Membership>::nodeAt(int index) const {
+  int from_end = length - 1 - index;
+  ListNode<T>* current;
+  if (std::min(index, from_end) < kMinStride) {
+    if (index <= from_end) {
+      current = head->next;
+      for (int position = 0; position < index; position++) current = current->next;
+    } else {
+      current = tail->prev;
+      for (int position = 0; position < from_end; position++) current = current->prev;
+    }
+    return current;
+  }
+
+  // pick a new stride when the list has grown or shrunk a lot since the
+  // last one was picked
+  long long square = (long long)stride * stride;
+  if (square > 4LL * length || length > 4 * square)
+    checkpoints.clear();
+  if (checkpoints.empty()) {
+    stride = std::max(kMinStride, (int)std::sqrt((double)length));
+    checkpoints.push_back(head->next);
+  }
+
+  int checkpoint = index / stride;
+  int offset = index - checkpoint * stride;
+  int count = (int)checkpoints.size();
+  if (checkpoint + 1 < count && offset > stride / 2) {
+    current = checkpoints[checkpoint + 1];
+    for (; offset < stride; offset++) current = current->prev;
+  } else if (checkpoint < count) {
+    current = checkpoints[checkpoint];
+    for (; offset > 0; offset--) current = current->next;
+  } else {
+    int position = (count - 1) * stride;
+    current = checkpoints.back();
+    while (position < index) {
+      current = current->next;
+      if (++position % stride == 0) checkpoints.push_back(current);
+    }
+  }
+  return current;
+}
+
+template<class T, class Allocator, class Membership>
+void LinkedList<T, Allocator, Membership>::shiftCheckpoints(int index, int shift) {
+  int count = (int)checkpoints.size();
+  for (int c = (index + stride - 1) / stride; c < count; c++)
+    checkpoints[c] = shift > 0 ? checkpoints[c]->prev : checkpoints[c]->next;
+  // the last checkpoint can move past the last node
+  if (count > 0 && checkpoints.back() == tail) checkpoints.pop_back();
 }
 
 // insert at certain length into list
 // adds to beginning if length is 0
 // adds to end if index is greater than length of list
-template<class T>
-void LinkedList<T>::insertAt(const T &value, const int index) {
+template<class T, class Allocator, class Membership>
+void LinkedList<T, Allocator, Membership>::insertAt(const T &value, const int index) {
   if (index >= length) {
     insertEnd(value);
   } else if (index == 0) {
     insertStart(value);
   } else {
-    int temp_position = 0;
-    ListNode<T>* current = head;
-    ListNode<T>* temp = new ListNode<T>(value);
-    while (temp_position < index) {
-      current = current->next;
-      temp_position++;
-    }
-    temp->prev = current;
-    temp->next = current->next;
-    current->next->prev = temp;
-    current->next = temp;
-    length++;
+    linkBefore(nodeAt(index), createNode(value));
+    shiftCheckpoints(index, 1);
   }
 }
 
-// removes first item from array
-// returns copy of item that was deleted
-template<class T>
-T LinkedList<T>::removeFirst() {
-  T temp_data = head->next->data;
-  if (length > 0) {
-    ListNode<T>* to_delete = head->next;
-    head->next = head->next->next;
-    head->next->prev = head;
-    delete to_delete;
-    length--;
+template<class T, class Allocator, class Membership>
+void LinkedList<T, Allocator, Membership>::insertAt(T &&value, const int index) {
+  if (index >= length) {
+    insertEnd(std::move(value));
+  } else if (index == 0) {
+    insertStart(std::move(value));
+  } else {
+    linkBefore(nodeAt(index), createNode(std::move(value)));
+    shiftCheckpoints(index, 1);
   }
-  return temp_data;
+}
+
+// removes first item from array
+// returns the item that was deleted, or a default T if the list is empty
+template<class T, class Allocator, class Membership>
+T LinkedList<T, Allocator, Membership>::removeFirst() {
+  if (length == 0) return T();
+  resetCheckpoints();
+  ListNode<T>* to_delete = head->next;
+  unlink(to_delete);
+  T data(std::move(to_delete->data));
+  destroyNode(to_delete);
+  return data;
 }
 
 // removes last item from array
-// returns copy of item that was deleted
-template<class T>
-T LinkedList<T>::removeLast() {
-  T temp_data = tail->prev->data;
-  if (length > 0) {
-    ListNode<T>* to_delete = tail->prev;
-    tail->prev = to_delete->prev;
-    to_delete->prev->next = tail;
-    delete to_delete;
-    length--;
-  }
-  return temp_data;
+// returns the item that was deleted, or a default T if the list is empty
+template<class T, class Allocator, class Membership>
+T LinkedList<T, Allocator, Membership>::removeLast() {
+  if (length == 0) return T();
+  shiftCheckpoints(length - 1, -1);
+  ListNode<T>* to_delete = tail->prev;
+  unlink(to_delete);
+  T data(std::move(to_delete->data));
+  destroyNode(to_delete);
+  return data;
 }
 
 // remove element at index
 // removes the last element if the index is greater than the length of the list
-template<class T>
-T LinkedList<T>::removeAt(const int index) {
+template<class T, class Allocator, class Membership>
+T LinkedList<T, Allocator, Membership>::removeAt(const int index) {
   if (index >= length) {
     return removeLast();
   } else if (index == 0) {
     return removeFirst();
   } else {
-    int temp_position = 0;
-    ListNode<T>* to_delete = head->next;
-    while (temp_position < index) {
-      to_delete = to_delete->next;
-      temp_position++;
-    }
-    to_delete->prev->next = to_delete->next;
-    to_delete->next->prev = to_delete->prev;
-    T data(to_delete->data);
-    delete to_delete;
-    length--;
+    ListNode<T>* to_delete = nodeAt(index);
+    shiftCheckpoints(index, -1);
+    unlink(to_delete);
+    T data(std::move(to_delete->data));
+    destroyNode(to_delete);
     return data;
   }
 }
 
-template<class T>
-bool LinkedList<T>::contains(const T &value) const {
+template<class T, class Allocator, class Membership>
+void LinkedList<T, Allocator, Membership>::linkBefore(ListNode<T>* position,
+                                              ListNode<T>* node) {
+  membership.add(node);
+  node->prev = position->prev;
+  node->next = position;
+  position->prev->next = node;
+  position->prev = node;
+  length++;
+}
+
+template<class T, class Allocator, class Membership>
+void LinkedList<T, Allocator, Membership>::unlink(ListNode<T>* node) {
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+  membership.remove(node);
+  length--;
+}
+
+template<class T, class Allocator, class Membership>
+template<class... Args>
+typename LinkedList<T, Allocator, Membership>::iterator
+LinkedList<T, Allocator, Membership>::emplace(const_iterator position, Args&&... args) {
+  // appending leaves every checkpoint in place
+  if (position.m_node != tail) resetCheckpoints();
+  ListNode<T>* node = createNode(std::in_place, std::forward<Args>(args)...);
+  linkBefore(position.m_node, node);
+  return iterator(node);
+}
+
+template<class T, class Allocator, class Membership>
+typename LinkedList<T, Allocator, Membership>::iterator
+LinkedList<T, Allocator, Membership>::insert(const_iterator position, const T& value) {
+  return emplace(position, value);
+}
+
+template<class T, class Allocator, class Membership>
+typename LinkedList<T, Allocator, Membership>::iterator
+LinkedList<T, Allocator, Membership>::insert(const_iterator position, T&& value) {
+  return emplace(position, std::move(value));
+}
+
+template<class T, class Allocator, class Membership>
+typename LinkedList<T, Allocator, Membership>::iterator
+LinkedList<T, Allocator, Membership>::erase(const_iterator position) {
+  if (position.m_node == tail->prev) shiftCheckpoints(length - 1, -1);
+  else resetCheckpoints();
+  ListNode<T>* next = position.m_node->next;
+  unlink(position.m_node);
+  destroyNode(position.m_node);
+  return iterator(next);
+}
+
+template<class T, class Allocator, class Membership>
+void LinkedList<T, Allocator, Membership>::splice(const_iterator position,
+                                          LinkedList& other_list) {
+  if (&other_list == this || other_list.length == 0) return;
+  resetCheckpoints();
+  other_list.resetCheckpoints();
+  ListNode<T>* first = other_list.head->next;
+  ListNode<T>* last = other_list.tail->prev;
+  other_list.head->next = other_list.tail;
+  other_list.tail->prev = other_list.head;
+
+  first->prev = position.m_node->prev;
+  last->next = position.m_node;
+  position.m_node->prev->next = first;
+  position.m_node->prev = last;
+  length += other_list.length;
+  other_list.length = 0;
+  if (Membership::kIndexed) {
+    other_list.membership.clear();
+    for (ListNode<T>* node = first; node != position.m_node; node = node->next)
+      membership.add(node);
+  }
+}
+
+template<class T, class Allocator, class Membership>
+void LinkedList<T, Allocator, Membership>::splice(const_iterator position,
+                                          LinkedList& other_list,
+                                          const_iterator element) {
+  if (element == position || element.m_node->next == position.m_node) return;
+  resetCheckpoints();
+  other_list.resetCheckpoints();
+  other_list.unlink(element.m_node);
+  linkBefore(position.m_node, element.m_node);
+}
+
+template<class T, class Allocator, class Membership>
+template<class Compare>
+ListNode<T>* LinkedList<T, Allocator, Membership>::mergeRuns(ListNode<T>* first,
+                                                   ListNode<T>* second,
+                                                   Compare& compare) {
+  ListNode<T>* merged = nullptr;
+  ListNode<T>** last = &merged;
+  while (first != nullptr && second != nullptr) {
+    if (compare(second->data, first->data)) {
+      *last = second;
+      second = second->next;
+    } else {
+      *last = first;
+      first = first->next;
+    }
+    last = &(*last)->next;
+  }
+  *last = first != nullptr ? first : second;
+  return merged;
+}
+
+// bottom up merge sort over the next pointers, prev pointers are fixed
+// afterwards
+template<class T, class Allocator, class Membership>
+template<class Compare>
+void LinkedList<T, Allocator, Membership>::sort(Compare compare) {
+  if (length < 2) return;
+  resetCheckpoints();
+  // runs[i] is empty or a sorted run of 2^i nodes, higher runs holding
+  // earlier nodes
+  ListNode<T>* runs[sizeof(int) * 8] = {};
+  ListNode<T>* current = head->next;
+  tail->prev->next = nullptr;
+  while (current != nullptr) {
+    ListNode<T>* run = current;
+    current = current->next;
+    run->next = nullptr;
+    int i = 0;
+    for (; runs[i] != nullptr; i++) {
+      run = mergeRuns(runs[i], run, compare);
+      runs[i] = nullptr;
+    }
+    runs[i] = run;
+  }
+
+  ListNode<T>* sorted = nullptr;
+  for (ListNode<T>* run : runs) {
+    if (run != nullptr)
+      sorted = sorted == nullptr ? run : mergeRuns(run, sorted, compare);
+  }
+
+  ListNode<T>* previous = head;
+  for (current = sorted; current != nullptr; current = current->next) {
+    previous->next = current;
+    current->prev = previous;
+    previous = current;
+  }
+  previous->next = tail;
+  tail->prev = previous;
+}
+
+template<class T, class Allocator, class Membership>
+void LinkedList<T, Allocator, Membership>::clear() {
+  resetCheckpoints();
+  ListNode<T>* current = head->next;
+  while (current != tail) {
+    ListNode<T>* next = current->next;
+    destroyNode(current);
+    current = next;
+  }
+  head->next = tail;
+  tail->prev = head;
+  length = 0;
+  membership.clear();
+}
+
+template<class T, class Allocator, class Membership>
+bool LinkedList<T, Allocator, Membership>::contains(const T &value) const {
+  if (Membership::kIndexed) return membership.find(value) != nullptr;
   ListNode<T>* current = head->next;
   while (current != tail) {
     if (current->data == value) {
@@ -266,42 +819,49 @@ bool LinkedList<T>::contains(const T &value) const {
   return false;
 }
 
-template<class T>
-T LinkedList<T>::getFirst() const {
+template<class T, class Allocator, class Membership>
+bool LinkedList<T, Allocator, Membership>::remove(const T &value) {
+  ListNode<T>* node = membership.find(value);
+  if (!Membership::kIndexed) {
+    for (node = head->next; node != tail && !(node->data == value);)
+      node = node->next;
+    if (node == tail) node = nullptr;
+  }
+  if (node == nullptr) return false;
+  erase(const_iterator(node));
+  return true;
+}
+
+template<class T, class Allocator, class Membership>
+const T& LinkedList<T, Allocator, Membership>::getFirst() const {
   return head->next->data;
 }
 
-template<class T>
-T LinkedList<T>::getLast() const {
+template<class T, class Allocator, class Membership>
+const T& LinkedList<T, Allocator, Membership>::getLast() const {
   return tail->prev->data;
 }
 
-template<class T>
-T LinkedList<T>::getItemAt(const int index) const {
+template<class T, class Allocator, class Membership>
+const T& LinkedList<T, Allocator, Membership>::getItemAt(const int index) const {
   if (index >= length) {
     return tail->prev->data;
   } else if (index == 0) {
     return head->next->data;
   } else {
-    int temp_position = 0;
-    ListNode<T>* current = head->next;
-    while (temp_position < index) {
-      current = current->next;
-      temp_position++;
-    }
-    return current->data;
+    return nodeAt(index)->data;
   }
 }
 
-template<class T>
-int LinkedList<T>::getLength() const {
+template<class T, class Allocator, class Membership>
+int LinkedList<T, Allocator, Membership>::getLength() const {
   return length;
 }
 
 // prints list in order in the form,
 // "Head -> data -> data -> data...."
-template<class T>
-void LinkedList<T>::print() const {
+template<class T, class Allocator, class Membership>
+void LinkedList<T, Allocator, Membership>::print() const {
   ListNode<T>* current = head->next;
   std::cout << "Head -> ";
   while (current != tail->prev) {
@@ -311,4 +871,72 @@ void LinkedList<T>::print() const {
   std::cout << current->data << std::endl;
 }
 
+template<class T, class Hash>
+void HashedMembership<T, Hash>::add(ListNode<T>* node) {
+  if ((m_count + 1) * 4 > m_slots.size() * 3) grow();
+  place(Slot{node, hash(node->data)});
+  m_count++;
+}
+
+template<class T, class Hash>
+std::size_t HashedMembership<T, Hash>::hash(const T& value) const {
+  std::uint64_t bits = m_hash(value);
+  bits = (bits ^ (bits >> 33)) * 0xff51afd7ed558ccdULL;
+  return static_cast<std::size_t>(bits ^ (bits >> 33));
+}
+
+template<class T, class Hash>
+void HashedMembership<T, Hash>::place(const Slot& slot) {
+  std::size_t mask = m_slots.size() - 1;
+  std::size_t i = slot.hash & mask;
+  while (m_slots[i].node != nullptr) i = (i + 1) & mask;
+  m_slots[i] = slot;
+}
+
+template<class T, class Hash>
+void HashedMembership<T, Hash>::grow() {
+  std::vector<Slot> old_slots(std::max<std::size_t>(16, m_slots.size() * 2),
+                              Slot{nullptr, 0});
+  old_slots.swap(m_slots);
+  for (const Slot& slot : old_slots)
+    if (slot.node != nullptr) place(slot);
+}
+
+// finds node's slot, then shifts back the slots after it that would
+// otherwise be cut off from their home slot by the gap
+template<class T, class Hash>
+void HashedMembership<T, Hash>::remove(ListNode<T>* node) {
+  std::size_t mask = m_slots.size() - 1;
+  std::size_t gap = hash(node->data) & mask;
+  while (m_slots[gap].node != node) gap = (gap + 1) & mask;
+  for (std::size_t i = (gap + 1) & mask; m_slots[i].node != nullptr; i = (i + 1) & mask) {
+    // distance from home to i, and from the gap to i
+    std::size_t home = m_slots[i].hash & mask;
+    if (((i - home) & mask) >= ((i - gap) & mask)) {
+      m_slots[gap] = m_slots[i];
+      gap = i;
+    }
+  }
+  m_slots[gap].node = nullptr;
+  m_count--;
+}
+
+template<class T, class Hash>
+void HashedMembership<T, Hash>::clear() {
+  std::fill(m_slots.begin(), m_slots.end(), Slot{nullptr, 0});
+  m_count = 0;
+}
+
+template<class T, class Hash>
+ListNode<T>* HashedMembership<T, Hash>::find(const T& value) const {
+  if (m_count == 0) return nullptr;
+  std::size_t mask = m_slots.size() - 1;
+  std::size_t value_hash = hash(value);
+  for (std::size_t i = value_hash & mask; m_slots[i].node != nullptr; i = (i + 1) & mask) {
+    if (m_slots[i].hash == value_hash && m_slots[i].node->data == value)
+      return m_slots[i].node;
+  }
+  return nullptr;
+}
+
 #endif  // LINKEDLIST_H_
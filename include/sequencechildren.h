@@ -0,0 +1,209 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+
+#ifndef SEQUENCECHILDREN_H_
+#define SEQUENCECHILDREN_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+
+// index of a word in a StringSequenceTrie's vocabulary
+typedef std::uint32_t WordId;
+
+// marks an empty slot / missing word
+const WordId kNoWord = UINT32_MAX;
+
+class StringSequenceTrieNode;
+
+// Compact map from word ids to the child nodes of a StringSequenceTrieNode.
+// Small fan-outs (the vast majority of nodes) are kept as a sorted array of
+// ids, larger ones are moved into an open addressing hash table. Node
+// pointers and ids share a single allocation. Hash tables also keep a short
+// list of their most seen children so predictions don't have to scan them.
+class SequenceChildren {
+ public:
+  // children are kept sorted while there are at most this many,
+  // beyond that they are moved into a hash table
+  static const std::uint32_t kMaxSortedChildren = 8;
+
+  // number of most seen children cached by each hash table
+  static const std::uint32_t kTopChildren = 4;
+
+  class const_iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef std::pair<WordId, StringSequenceTrieNode*> value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const value_type* pointer;
+    typedef value_type reference;
+
+    const_iterator(const SequenceChildren* children, std::uint32_t index)
+        : m_children(children), m_index(index) { skipEmpty(); }
+
+    value_type operator*() const {
+      return value_type(m_children->idAt(m_index),
+                        m_children->m_nodes[m_index]);
+    }
+    const_iterator& operator++() { m_index++; skipEmpty(); return *this; }
+    bool operator==(const const_iterator& other) const {
+      return m_index == other.m_index;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return m_index != other.m_index;
+    }
+
+   private:
+    void skipEmpty() {
+      std::uint32_t end = m_children->slotCount();
+      while (m_index < end && m_children->idAt(m_index) == kNoWord) m_index++;
+    }
+    const SequenceChildren* m_children;
+    std::uint32_t m_index;
+  };
+
+  SequenceChildren() : m_nodes(nullptr), m_size(0), m_capacity(0) {}
+  // releases the arrays, the child nodes themselves are owned by the trie
+  ~SequenceChildren();
+
+  SequenceChildren(const SequenceChildren&) = delete;
+  SequenceChildren& operator=(const SequenceChildren&) = delete;
+
+  inline std::size_t size() const { return m_size; }
+  inline bool empty() const { return m_size == 0; }
+
+  // returns the child for id, nullptr if there isn't one
+  StringSequenceTrieNode* find(const WordId id) const;
+
+  // returns a reference to the slot holding the child for id. If id is not
+  // present a slot containing nullptr is inserted for the caller to fill in
+  StringSequenceTrieNode*& findOrInsert(const WordId id);
+
+  // removes id, returns false if it was not present
+  bool erase(const WordId id);
+
+  // removes every child for which predicate(child) returns true, then
+  // shrinks the arrays to fit the rest. predicate is called once per child
+  // and may delete it. returns the number of children removed
+  template <typename Predicate>
+  std::uint32_t eraseIf(Predicate predicate);
+
+  // copies up to limit (at most kTopChildren) of the most seen children
+  // into top, most seen first, and returns how many were copied. Hash tables
+  // read their cached list, sorted arrays are small enough to scan
+  std::uint32_t getTopChildren(StringSequenceTrieNode** top,
+                               std::uint32_t limit) const;
+
+  // must be called after the count of child goes up. counts only grow
+  // between calls, so the cached list stays exact in O(kTopChildren)
+  inline void updateTop(StringSequenceTrieNode* child) {
+    if (isHashed()) pushTop(top(), child);
+  }
+
+  // recomputes the cached list from every child, needed after counts
+  // are lowered or updateTop was skipped
+  void rebuildTop();
+
+  // removes all children and releases the arrays
+  void clear();
+
+  // number of heap bytes held by the arrays
+  std::size_t memoryUsage() const;
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, slotCount()); }
+
+ private:
+  inline bool isHashed() const { return m_capacity > kMaxSortedChildren; }
+  inline std::uint32_t slotCount() const {
+    return isHashed() ? m_capacity : m_size;
+  }
+  // the allocation holds the top children (hash tables only), then the
+  // node pointers followed by the ids
+  static inline std::uint32_t topSlots(std::uint32_t capacity) {
+    return capacity > kMaxSortedChildren ? kTopChildren : 0;
+  }
+  inline StringSequenceTrieNode** top() const {
+    return m_nodes - topSlots(m_capacity);
+  }
+
+  // adds child to a nullptr padded list of the kTopChildren most seen
+  // children, or moves it up if it is already there
+  static void pushTop(StringSequenceTrieNode** top,
+                      StringSequenceTrieNode* child);
+  inline WordId* ids() const {
+    return reinterpret_cast<WordId*>(m_nodes + m_capacity);
+  }
+  inline WordId idAt(std::uint32_t index) const { return ids()[index]; }
+
+  inline std::uint32_t hashSlot(const WordId id) const {
+    std::uint32_t hash = id * 2654435761u;
+    return (hash ^ (hash >> 16)) & (m_capacity - 1);
+  }
+
+  // moves the children into arrays with new_capacity slots, switching
+  // between the sorted and hashed layouts when the capacity crosses
+  // kMaxSortedChildren
+  void reallocate(std::uint32_t new_capacity);
+
+  // moves the children into the smallest arrays that hold them, used
+  // after eraseIf has emptied slots
+  void shrinkToFit();
+
+  StringSequenceTrieNode** m_nodes;
+  std::uint32_t m_size;
+  std::uint32_t m_capacity;
+};
+
+template <typename Predicate>
+std::uint32_t SequenceChildren::eraseIf(Predicate predicate) {
+  WordId* id_array = ids();
+  const bool hashed = isHashed();
+  std::uint32_t kept = 0, removed = 0;
+  for (std::uint32_t i = 0, slots = slotCount(); i < slots; i++) {
+    if (id_array[i] == kNoWord) continue;
+    if (predicate(m_nodes[i])) {
+      // hash tables are left with holes that shrinkToFit rehashes away
+      if (hashed) {
+        id_array[i] = kNoWord;
+        m_nodes[i] = nullptr;
+      }
+      removed++;
+    } else if (!hashed) {
+      id_array[kept] = id_array[i];
+      m_nodes[kept] = m_nodes[i];
+      kept++;
+    }
+  }
+  if (removed == 0) return 0;
+
+  m_size -= removed;
+  shrinkToFit();
+  return removed;
+}
+
+#endif  // SEQUENCECHILDREN_H_
@@ -0,0 +1,113 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+#ifndef SEQUENCEGENERATOR_H_
+#define SEQUENCEGENERATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "stringsequencetrie.h"
+
+// Generates text by sampling each next word from the counts stored in a
+// StringSequenceTrie, conditioned on up to window size - 1 previous words.
+// The generator keeps a cursor on the node of its current context instead
+// of looking the context up again for every word. The first time a context
+// is reached its next words are put in an alias table (Walker / Vose), so
+// sampling a word costs one random number and two array reads, and each
+// entry remembers the table of the context the word leads to. Contexts
+// that were never continued in the text back off to their longest suffix
+// that was. Not thread safe, use one generator per thread.
+class SequenceGenerator {
+ public:
+  // trie must outlive the generator and must not change while it's used
+  explicit SequenceGenerator(const StringSequenceTrie &trie,
+                             double temperature = 1.0, int top_k = 0,
+                             std::uint64_t seed = 5489);
+  ~SequenceGenerator();
+
+  SequenceGenerator(const SequenceGenerator&) = delete;
+  SequenceGenerator& operator=(const SequenceGenerator&) = delete;
+
+  // each word is picked with probability proportional to
+  // count ^ (1 / temperature), so below 1 sharpens the distribution and
+  // above 1 flattens it. 0 always picks the most seen word
+  void setTemperature(double temperature);
+
+  // only samples among the top_k most seen next words, 0 for all of them
+  void setTopK(int top_k);
+
+  void setSeed(std::uint64_t seed) { m_random.seed(seed); }
+
+  // continues after words, only the last window size - 1 are used. an
+  // empty context starts from the word counts alone
+  void setContext(const WordId* words, int length);
+  void setContext(std::string_view words);
+
+  // samples the next word and moves the context on, returns kNoWord if the
+  // trie is empty
+  WordId nextWord();
+
+  // appends count sampled words to words
+  void generate(std::size_t count, std::vector<WordId>* words);
+
+  // returns count sampled words separated by spaces
+  std::string generateText(std::size_t count);
+
+  // number of contexts an alias table has been built for
+  std::size_t getNumberTables() const { return m_tables.size(); }
+
+ private:
+  struct AliasTable;
+
+  // returns node's table, building it the first time
+  AliasTable* getTable(const StringSequenceTrieNode* node);
+
+  // the node of the longest suffix of words that has next words, the
+  // trie's head if none has
+  const StringSequenceTrieNode* findContext(const WordId* words,
+                                            int length) const;
+
+  // drops every table, keeping the cursor on the same context
+  void clearTables();
+
+  const StringSequenceTrie &m_trie;
+  double m_temperature;
+  int m_top_k;
+  std::mt19937_64 m_random;
+
+  std::unordered_map<const StringSequenceTrieNode*,
+                     std::unique_ptr<AliasTable>> m_tables;
+  // table of the current context
+  AliasTable* m_table;
+};
+
+#endif  // SEQUENCEGENERATOR_H_
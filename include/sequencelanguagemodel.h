@@ -0,0 +1,92 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+
+#ifndef SEQUENCELANGUAGEMODEL_H_
+#define SEQUENCELANGUAGEMODEL_H_
+
+#include <string>
+#include <vector>
+
+#include "stringsequencetrie.h"
+
+// Scores word sequences with the n-gram counts stored in a
+// StringSequenceTrie. The order of the model is the trie's window size.
+// Queries only walk the trie and read counts cached on its nodes by
+// StringSequenceTrie::updateContinuationCounts, so scoring doesn't allocate.
+class SequenceLanguageModel {
+ public:
+  enum class Smoothing {
+    // interpolated Kneser-Ney with a single absolute discount, returns
+    // probabilities
+    kKneserNey,
+    // stupid backoff (Brants et al. 2007), returns relative scores that
+    // don't sum to one but are cheaper and work well for ranking
+    kStupidBackoff
+  };
+
+  // trie must outlive the model, and updateContinuationCounts must have
+  // been called on it since it last changed
+  explicit SequenceLanguageModel(const StringSequenceTrie &trie,
+                                 Smoothing smoothing = Smoothing::kKneserNey,
+                                 double discount = 0.75,
+                                 double backoff_weight = 0.4);
+
+  // returns P(word | context), only the last order - 1 words of the
+  // context are used. unknown words (kNoWord) get a share of the
+  // probability left over by the uniform distribution
+  double getProbability(const WordId* context, int context_length,
+                        WordId word) const;
+
+  // returns the natural log probability of the words, each word being
+  // conditioned on the order - 1 words before it
+  double getLogProbability(const WordId* words, int length) const;
+
+  // tokenizes sentence with the trie's vocabulary and scores it
+  double getLogProbability(const std::string &sentence) const;
+
+  // scores every sentence into scores, which is only resized
+  void scoreSentences(const std::vector<std::vector<WordId>> &sentences,
+                      std::vector<double>* scores) const;
+
+  // fills ranking with the indices of the sentences, most likely first
+  void rankSentences(const std::vector<std::vector<WordId>> &sentences,
+                     std::vector<double>* scores,
+                     std::vector<int>* ranking) const;
+
+ private:
+  double getKneserNeyProbability(const WordId* context, int context_length,
+                                 WordId word) const;
+
+  double getStupidBackoffScore(const WordId* context, int context_length,
+                               WordId word) const;
+
+  const StringSequenceTrie &m_trie;
+  Smoothing m_smoothing;
+  double m_discount;
+  double m_backoff_weight;
+};
+
+#endif  // SEQUENCELANGUAGEMODEL_H_
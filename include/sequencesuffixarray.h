@@ -0,0 +1,158 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+
+#ifndef SEQUENCESUFFIXARRAY_H_
+#define SEQUENCESUFFIXARRAY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "sequencechildren.h"
+#include "stringsequencetrie.h"
+
+// Alternative to StringSequenceTrie that keeps the loaded text as a
+// sequence of word ids plus a suffix array over it. The occurences of any
+// sequence are one contiguous range of the suffix array, sorted by the
+// word that follows, so counts and continuations are answered for
+// sequences of any length with binary searches. Memory is 8 bytes per word
+// of text no matter how long the sequences queried are, where a trie
+// grows with every window position.
+class SequenceSuffixArray {
+ public:
+  SequenceSuffixArray() {}
+
+  SequenceSuffixArray(const SequenceSuffixArray&) = delete;
+  SequenceSuffixArray& operator=(const SequenceSuffixArray&) = delete;
+
+  // appends the words as a separate document, no sequence spans two
+  // documents. The suffix array is rebuilt, so large texts should be
+  // added in one call
+  void addSequence(const std::vector<std::string> &sequence);
+  void addSequence(const std::string_view* words, std::size_t count);
+
+  // reads books/file_name with a CorpusReader, like StringSequenceTrie
+  void loadTextFile(std::string file_name = "");
+
+  // reads each file as a document and builds the suffix array once
+  void loadTextFiles(const std::vector<std::string> &file_names);
+
+  // returns the id of word, kNoWord if it has never been added
+  WordId getWordId(std::string_view word) const;
+
+  // returns the string for a word id
+  const std::string& getWord(WordId word) const { return m_words[word]; }
+
+  // splits sequence on spaces and looks up each word, unknown words are
+  // returned as kNoWord
+  std::vector<WordId> getWordIds(std::string_view sequence) const;
+
+  // returns the number of times the words appear in the text in order
+  std::size_t getCount(const WordId* words, int length) const;
+  std::size_t getCount(std::string_view sequence) const;
+
+  // same as StringSequenceTrie::predictNextWords, without a limit on the
+  // length of the context
+  int predictNextWords(const WordId* context, int context_length,
+                       std::vector<WordId>* next_words,
+                       int limit = SequenceChildren::kTopChildren) const;
+
+  // returns the word most often seen after sequence, backing off to shorter
+  // sequences if it has never been seen. returns "" for an empty text
+  std::string getNextWord(std::string_view sequence) const;
+
+  // returns the sequences StringSequenceTrie::getOrderedWords would, as
+  // their words and number of occurences, most frequent first
+  std::vector<std::pair<std::string, int>> getOrderedWords(
+      const StringSequenceTrie::SequenceCriteria &criteria, int limit = 0) const;
+
+  // returns the number of words in the text
+  std::size_t getNumberWords() const { return m_text.size() - m_documents; }
+
+  // returns the number of distinct words
+  std::size_t getNumberUniqueWords() const { return m_words.size(); }
+
+  // returns the number of heap bytes used by the text and suffix array
+  std::size_t memoryUsage() const;
+
+ private:
+  // suffixes [begin, end) of the suffix array
+  struct Range {
+    std::uint32_t begin;
+    std::uint32_t end;
+    std::uint32_t size() const { return end - begin; }
+  };
+
+  // state shared by the recursive calls of getOrderedWordsHelper
+  struct OrderedWordsSearch;
+
+  // returns the word depth words into suffix, every suffix of a real word
+  // runs into the document separator before the end of the text
+  WordId wordAt(std::uint32_t suffix, int depth) const {
+    return m_text[m_suffixes[suffix] + depth];
+  }
+
+  // returns the suffixes starting with the words, an empty range if the
+  // sequence never appears
+  Range find(const WordId* words, int length) const;
+
+  // narrows range, whose suffixes share their first depth words, to those
+  // followed by word
+  Range narrow(Range range, int depth, WordId word) const;
+
+  // calls visit(word, range) for each distinct word following the first
+  // depth words shared by range's suffixes, in word id order
+  template <typename Visitor>
+  void forEachNextWord(Range range, int depth, Visitor visit) const;
+
+  void getOrderedWordsHelper(Range range, int depth, OrderedWordsSearch *search,
+                             int current_sequence_length) const;
+
+  // adds word to the vocabulary and returns its id
+  WordId addWord(std::string_view word);
+
+  // appends the words of file_name to the text, returns false if it
+  // couldn't be opened
+  bool readTextFile(const std::string &file_name);
+
+  // sorts the suffixes of m_text by prefix doubling
+  void buildSuffixArray();
+
+  // word ids of every document, each followed by kNoWord
+  std::vector<WordId> m_text;
+  // start of each suffix of m_text, in sorted order
+  std::vector<std::uint32_t> m_suffixes;
+  std::size_t m_documents = 0;
+
+  std::unordered_map<std::string, WordId> m_word_ids;
+  std::vector<std::string> m_words;
+};
+
+#endif  // SEQUENCESUFFIXARRAY_H_
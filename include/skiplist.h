@@ -23,48 +23,150 @@
 **  SOFTWARE.                                                                      **
 **                                                                                 **
 ************************************************************************************/
+
 #ifndef SKIPLIST_H_
 #define SKIPLIST_H_
-#include <vector>
-#include <random>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <random>
+#include <utility>
 
 ///////////////////////////////////////////////////////////////////////////////
 // DECLARATIONS
 ///////////////////////////////////////////////////////////////////////////////
 
-template<class T>
-struct SkipListNode {
+// link back to the node before on level 0, left out of nodes of skip lists
+// that don't keep one
+template<class Node, bool kBackLink>
+struct SkipListBackLink {
+  Node* prev;
+};
+
+template<class Node>
+struct SkipListBackLink<Node, false> {};
+
+// Skip list node. Its tower of next links is allocated right after it, so
+// a node is a single allocation and a hop reaches the next node without
+// going through a separate buffer
+template<class T, bool kBackLink = true>
+struct SkipListNode : SkipListBackLink<SkipListNode<T, kBackLink>, kBackLink> {
   T data;
-  std::vector<SkipListNode<T>*> next;
-  std::vector<SkipListNode<T>*> prev;
-  // creates empty list node
-  SkipListNode();
-  // creates list node containing value
-  explicit SkipListNode(const T& value);
+  // number of links in the tower
+  int level;
+
+  // allocates a node with a tower of level null links, data constructed
+  // from args
+  template<class... Args>
+  static SkipListNode* create(int level, Args&&... args);
+  // destroys and frees a node made by create
+  static void destroy(SkipListNode* node);
+
+  // the link to the next node on level i, i below level
+  SkipListNode*& next(int i) { return tower()[i]; }
+  SkipListNode* next(int i) const { return tower()[i]; }
+
+ private:
+  template<class... Args>
+  explicit SkipListNode(int node_level, Args&&... args)
+      : data(std::forward<Args>(args)...), level(node_level) {}
+  ~SkipListNode() {}
+
+  // offset of the tower from the start of the node
+  static std::size_t towerOffset() {
+    return (sizeof(SkipListNode) + alignof(SkipListNode*) - 1) /
+           alignof(SkipListNode*) * alignof(SkipListNode*);
+  }
+  SkipListNode** tower() const {
+    return reinterpret_cast<SkipListNode**>(
+        reinterpret_cast<char*>(const_cast<SkipListNode*>(this)) + towerOffset());
+  }
 };
 
-template<class T, class CompareFunc = std::less<T>>
+// Ordered multiset. Nodes get a random level, each level up holding about
+// half the nodes of the one below, with levels capped at about log2 of
+// the length so a run of lucky draws can't build towers searches never
+// use. With kBackLinks nodes link back to the node before them on level
+// 0, making getLast and stepping iterators back constant time at the cost
+// of a pointer per node. Without, both search for the node before.
+template<class T, class CompareFunc = std::less<T>, bool kBackLinks = true>
 class SkipList {
  public:
+  typedef SkipListNode<T, kBackLinks> Node;
+
+  // bidirectional iterator over the values in order. values can't be
+  // changed in place, as that could break the order
+  class const_iterator {
+   public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T* pointer;
+    typedef const T& reference;
+
+    const_iterator() : m_list(nullptr), m_node(nullptr) {}
+
+    reference operator*() const { return m_node->data; }
+    pointer operator->() const { return &m_node->data; }
+    const_iterator& operator++() { m_node = m_node->next(0); return *this; }
+    const_iterator operator++(int) { const_iterator temp(*this); ++*this; return temp; }
+    const_iterator& operator--() { m_node = m_list->previousNode(m_node); return *this; }
+    const_iterator operator--(int) { const_iterator temp(*this); --*this; return temp; }
+    bool operator==(const const_iterator& other) const { return m_node == other.m_node; }
+    bool operator!=(const const_iterator& other) const { return m_node != other.m_node; }
+
+   private:
+    friend class SkipList;
+    const_iterator(const SkipList* list, Node* node) : m_list(list), m_node(node) {}
+
+    const SkipList* m_list;
+    Node* m_node;
+  };
+
+  typedef const_iterator iterator;
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+  typedef const_reverse_iterator reverse_iterator;
+
   // default constructor
   SkipList();
   // copy constructor
-  explicit SkipList(const SkipList& other_list);
+  SkipList(const SkipList& other_list);
   // destructor
   ~SkipList();
   // assignment operator
   SkipList& operator=(const SkipList& other_list);
 
-  // insert value into list
+  // insert value into list, before any equal values
   void insert(const T& value);
 
-  // remove value from list
+  // remove value from list, the first one if there are several
   void remove(const T& value);
 
   // returns true if value is in the list
   bool contains(const T& value) const;
 
+  // removes every value
+  void clear();
+
+  const_iterator begin() const { return const_iterator(this, head->next(0)); }
+  const_iterator end() const { return const_iterator(this, tail); }
+  const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+  const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+  // returns the first value not ordered before value, end() if none
+  const_iterator lower_bound(const T& value) const;
+  // returns the first value ordered after value, end() if none
+  const_iterator upper_bound(const T& value) const;
+
+  // calls callback(value) for every value from low up to, but not
+  // including, high, in order. one search finds low, the rest are read
+  // off level 0. returns the number of values visited
+  template<class Callback>
+  int rangeScan(const T& low, const T& high, Callback callback) const;
+
   // returns first element in the list
   T getFirst() const;
   // returns last element in the list
@@ -73,6 +175,9 @@ class SkipList {
   // returns number of elements in the list
   inline int getLength() const;
 
+  // returns number of levels in use
+  int getLevel() const { return level; }
+
   // returns true if list is empty
   inline bool isEmpty() const;
 
@@ -81,172 +186,304 @@ class SkipList {
   void print() const;
 
  private:
+  // most levels a list can have, enough for any int length
+  static const int kMaxLevel = 32;
+
+  // fills update[i] with the last node before value on level i, for every
+  // level in use, and returns the node after update[0]
+  Node* findPredecessors(const T& value, Node** update) const;
+
   // finds value in list and returns pointer to that node
   // returns null pointer if value is not in list
-  SkipListNode<T>* findNode(const T& value) const;
+  Node* findNode(const T& value) const;
+
+  // returns the node before node on level 0, head for the first
+  Node* previousNode(Node* node) const;
+
+  // draws the level of a new node
+  int randomLevel();
+
+  // appends the elements of other_list, which are in order
+  void copyElements(const SkipList& other_list);
 
-  // used by insert method to determine if new skip list layer
-  // should be created
-  std::default_random_engine m_generator;
-  std::bernoulli_distribution m_distribution;
+  // picks node levels
+  std::mt19937 m_generator;
 
   // comparison functor used to define the order of the skip list
   CompareFunc comp;
 
-  SkipListNode<T>* head;
-  SkipListNode<T>* tail;
+  Node* head;
+  Node* tail;
   int length;
+  int level;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 // DEFINITIONS
 ///////////////////////////////////////////////////////////////////////////////
 
-template<class T>
-SkipListNode<T>::SkipListNode() {
-  next.push_back(nullptr);
-  prev.push_back(nullptr);
+template<class T, bool kBackLink>
+template<class... Args>
+SkipListNode<T, kBackLink>* SkipListNode<T, kBackLink>::create(int level,
+                                                               Args&&... args) {
+  void* memory = ::operator new(towerOffset() + level * sizeof(SkipListNode*),
+                                std::align_val_t(alignof(SkipListNode)));
+  SkipListNode* node;
+  try {
+    node = new (memory) SkipListNode(level, std::forward<Args>(args)...);
+  } catch (...) {
+    ::operator delete(memory, std::align_val_t(alignof(SkipListNode)));
+    throw;
+  }
+  for (int i = 0; i < level; i++) node->next(i) = nullptr;
+  if constexpr (kBackLink) node->prev = nullptr;
+  return node;
 }
 
-template<class T>
-SkipListNode<T>::SkipListNode(const T &value) {
-  data = value;
-  next.push_back(nullptr);
-  prev.push_back(nullptr);
+template<class T, bool kBackLink>
+void SkipListNode<T, kBackLink>::destroy(SkipListNode* node) {
+  node->~SkipListNode();
+  ::operator delete(node, std::align_val_t(alignof(SkipListNode)));
 }
 
-template<class T, class CompareFunc>
-SkipList<T, CompareFunc>::SkipList() : m_distribution(.5) {
+template<class T, class CompareFunc, bool kBackLinks>
+SkipList<T, CompareFunc, kBackLinks>::SkipList() {
   length = 0;
-  tail = new SkipListNode<T>();
-  head = new SkipListNode<T>();
-  head->next[0] = tail;
-  tail->prev[0] = head;
+  level = 1;
+  tail = Node::create(0);
+  head = Node::create(kMaxLevel);
+  for (int i = 0; i < kMaxLevel; i++) head->next(i) = tail;
+  if constexpr (kBackLinks) tail->prev = head;
+}
+
+template<class T, class CompareFunc, bool kBackLinks>
+SkipList<T, CompareFunc, kBackLinks>::SkipList(const SkipList& other_list)
+    : SkipList() {
+  comp = other_list.comp;
+  copyElements(other_list);
+}
+
+template<class T, class CompareFunc, bool kBackLinks>
+SkipList<T, CompareFunc, kBackLinks>::~SkipList() {
+  clear();
+  Node::destroy(head);
+  Node::destroy(tail);
+}
+
+template<class T, class CompareFunc, bool kBackLinks>
+SkipList<T, CompareFunc, kBackLinks>&
+SkipList<T, CompareFunc, kBackLinks>::operator=(const SkipList& other_list) {
+  if (this != &other_list) {
+    clear();
+    comp = other_list.comp;
+    copyElements(other_list);
+  }
+  return *this;
+}
+
+// the elements arrive in order, so each is linked in after the last node
+// on each of its levels without a search
+template<class T, class CompareFunc, bool kBackLinks>
+void SkipList<T, CompareFunc, kBackLinks>::copyElements(const SkipList& other_list) {
+  Node* last[kMaxLevel];
+  for (int i = 0; i < kMaxLevel; i++) last[i] = head;
+  for (Node* current = other_list.head->next(0); current != other_list.tail;
+       current = current->next(0)) {
+    int node_level = randomLevel();
+    Node* node = Node::create(node_level, current->data);
+    for (int i = 0; i < node_level; i++) {
+      node->next(i) = tail;
+      last[i]->next(i) = node;
+      last[i] = node;
+    }
+    if constexpr (kBackLinks) {
+      node->prev = tail->prev;
+      tail->prev = node;
+    }
+    if (node_level > level) level = node_level;
+    length++;
+  }
 }
 
-template<class T, class CompareFunc>
-SkipList<T, CompareFunc>::~SkipList() {
-  SkipListNode<T>* current = head;
-  SkipListNode<T>* next;
+template<class T, class CompareFunc, bool kBackLinks>
+void SkipList<T, CompareFunc, kBackLinks>::clear() {
+  Node* current = head->next(0);
   while (current != tail) {
-    next = current->next.front();
-    delete current;
+    Node* next = current->next(0);
+    Node::destroy(current);
     current = next;
   }
-  delete current;
+  for (int i = 0; i < kMaxLevel; i++) head->next(i) = tail;
+  if constexpr (kBackLinks) tail->prev = head;
+  length = 0;
+  level = 1;
+}
+
+// one draw of the generator gives the level: each further level needs one
+// more low bit set. the cap grows with the length, log2 of it plus two
+template<class T, class CompareFunc, bool kBackLinks>
+int SkipList<T, CompareFunc, kBackLinks>::randomLevel() {
+  int cap = 2;
+  for (unsigned int count = length + 1; count > 1 && cap < kMaxLevel; count >>= 1)
+    cap++;
+  int node_level = 1;
+  for (std::uint_fast32_t bits = m_generator(); (bits & 1) && node_level < cap;
+       bits >>= 1) {
+    node_level++;
+  }
+  return node_level;
 }
 
-template<class T, class CompareFunc>
-void SkipList<T, CompareFunc>::insert(const T &value) {
-  int current_level = head->next.size() - 1;
-  std::vector<SkipListNode<T>*> jump_list(head->next.size());
-  SkipListNode<T>* current = head;
-  SkipListNode<T>* next = current->next.back();
-  while (current_level > 0) {
-    if (next != tail && comp(current->next[current_level]->data, value)) {
+template<class T, class CompareFunc, bool kBackLinks>
+typename SkipList<T, CompareFunc, kBackLinks>::Node*
+SkipList<T, CompareFunc, kBackLinks>::findPredecessors(const T& value,
+                                                       Node** update) const {
+  Node* current = head;
+  for (int i = level - 1; i >= 0; i--) {
+    Node* next = current->next(i);
+    while (next != tail && comp(next->data, value)) {
       current = next;
-      next = next->next.at(current_level);
-    } else {
-      jump_list[current_level] = current;
-      current_level--;
-      next = current->next.at(current_level);
+      next = current->next(i);
     }
+    update[i] = current;
   }
-  while (next != tail && comp(current->next[current_level]->data, value)) {
-    current = next;
-    next = next->next[0];
+  return current->next(0);
+}
+
+template<class T, class CompareFunc, bool kBackLinks>
+void SkipList<T, CompareFunc, kBackLinks>::insert(const T &value) {
+  Node* update[kMaxLevel];
+  findPredecessors(value, update);
+  int node_level = randomLevel();
+  for (; level < node_level; level++) update[level] = head;
+
+  Node* node = Node::create(node_level, value);
+  for (int i = 0; i < node_level; i++) {
+    node->next(i) = update[i]->next(i);
+    update[i]->next(i) = node;
   }
-  SkipListNode<T>* node_to_add = new SkipListNode<T>(value);
-  node_to_add->next[0] = next;
-  next->prev[0] = node_to_add;
-  node_to_add->prev[0] = current;
-  current->next[0] = node_to_add;
-
-  int size = jump_list.size();
-  int index = 1;
-  while (m_distribution(m_generator)) {
-    if (index < size) {
-      current = jump_list[index];
-      next = current->next[index];
-
-      node_to_add->next.push_back(next);
-      next->prev[index] = node_to_add;
-
-      node_to_add->prev.push_back(current);
-      current->next[index] = node_to_add;
-      index++;
-    } else {
-      head->next.push_back(node_to_add);
-      node_to_add->prev.push_back(head);
-      node_to_add->next.push_back(tail);
-      tail->prev.push_back(node_to_add);
-    }
+  if constexpr (kBackLinks) {
+    node->prev = update[0];
+    node->next(0)->prev = node;
   }
   length++;
 }
 
-template<class T, class CompareFunc>
-void SkipList<T, CompareFunc>::remove(const T &value) {
-  SkipListNode<T>* node_to_delete = findNode(value);
-  if (node_to_delete != nullptr) {
-    for (int i = node_to_delete->next.size() - 1; i >= 0; i--) {
-      node_to_delete->prev[i]->next[i] = node_to_delete->next[i];
-      node_to_delete->next[i]->prev[i] = node_to_delete->prev[i];
+template<class T, class CompareFunc, bool kBackLinks>
+void SkipList<T, CompareFunc, kBackLinks>::remove(const T &value) {
+  Node* update[kMaxLevel];
+  Node* node_to_delete = findPredecessors(value, update);
+  if (node_to_delete == tail || comp(value, node_to_delete->data)) return;
+
+  for (int i = 0; i < node_to_delete->level; i++)
+    update[i]->next(i) = node_to_delete->next(i);
+  if constexpr (kBackLinks) node_to_delete->next(0)->prev = update[0];
+  Node::destroy(node_to_delete);
+  while (level > 1 && head->next(level - 1) == tail) level--;
+  length--;
+}
+
+template<class T, class CompareFunc, bool kBackLinks>
+bool SkipList<T, CompareFunc, kBackLinks>::contains(const T &value) const {
+  return findNode(value) != nullptr;
+}
+
+template<class T, class CompareFunc, bool kBackLinks>
+T SkipList<T, CompareFunc, kBackLinks>::getFirst() const {
+  return head->next(0)->data;
+}
+
+template<class T, class CompareFunc, bool kBackLinks>
+T SkipList<T, CompareFunc, kBackLinks>::getLast() const {
+  return previousNode(tail)->data;
+}
+
+// without back links, searches for the last node ordered before node and
+// walks on from there past the ones equal to it
+template<class T, class CompareFunc, bool kBackLinks>
+typename SkipList<T, CompareFunc, kBackLinks>::Node*
+SkipList<T, CompareFunc, kBackLinks>::previousNode(Node* node) const {
+  if constexpr (kBackLinks) {
+    return node->prev;
+  } else {
+    Node* current = head;
+    for (int i = level - 1; i >= 0; i--) {
+      Node* next = current->next(i);
+      while (next != tail && (node == tail || comp(next->data, node->data))) {
+        current = next;
+        next = current->next(i);
+      }
     }
-    delete node_to_delete;
-    length--;
+    while (current->next(0) != node) current = current->next(0);
+    return current;
   }
 }
 
-template<class T, class CompareFunc>
-bool SkipList<T, CompareFunc>::contains(const T &value) const {
-  SkipListNode<T>* current = findNode(value);
-  if (current != nullptr) {
-    return true;
-  } else {
-    return false;
+template<class T, class CompareFunc, bool kBackLinks>
+typename SkipList<T, CompareFunc, kBackLinks>::const_iterator
+SkipList<T, CompareFunc, kBackLinks>::lower_bound(const T& value) const {
+  Node* current = head;
+  for (int i = level - 1; i >= 0; i--) {
+    Node* next = current->next(i);
+    while (next != tail && comp(next->data, value)) {
+      current = next;
+      next = current->next(i);
+    }
   }
+  return const_iterator(this, current->next(0));
 }
 
-template<class T, class CompareFunc>
-int SkipList<T, CompareFunc>::getLength() const {
+template<class T, class CompareFunc, bool kBackLinks>
+typename SkipList<T, CompareFunc, kBackLinks>::const_iterator
+SkipList<T, CompareFunc, kBackLinks>::upper_bound(const T& value) const {
+  Node* current = head;
+  for (int i = level - 1; i >= 0; i--) {
+    Node* next = current->next(i);
+    while (next != tail && !comp(value, next->data)) {
+      current = next;
+      next = current->next(i);
+    }
+  }
+  return const_iterator(this, current->next(0));
+}
+
+template<class T, class CompareFunc, bool kBackLinks>
+template<class Callback>
+int SkipList<T, CompareFunc, kBackLinks>::rangeScan(const T& low, const T& high,
+                                                    Callback callback) const {
+  int count = 0;
+  for (Node* current = lower_bound(low).m_node;
+       current != tail && comp(current->data, high); current = current->next(0)) {
+    callback(current->data);
+    count++;
+  }
+  return count;
+}
+
+template<class T, class CompareFunc, bool kBackLinks>
+int SkipList<T, CompareFunc, kBackLinks>::getLength() const {
   return length;
 }
 
-template<class T, class CompareFunc>
-bool SkipList<T, CompareFunc>::isEmpty() const {
+template<class T, class CompareFunc, bool kBackLinks>
+bool SkipList<T, CompareFunc, kBackLinks>::isEmpty() const {
   return length == 0;
 }
 
-template<class T, class CompareFunc>
-void SkipList<T, CompareFunc>::print() const {
-  SkipListNode<T>* current = head->next[0];
+template<class T, class CompareFunc, bool kBackLinks>
+void SkipList<T, CompareFunc, kBackLinks>::print() const {
   std::cout << "Head -> ";
-  while (current != tail->prev[0]) {
+  for (Node* current = head->next(0); current != tail; current = current->next(0))
     std::cout << current->data << " -> ";
-    current = current->next[0];
-  }
-  std::cout << current->data << " -> Tail" << std::endl;
-}
-
-template<class T, class CompareFunc>
-SkipListNode<T>* SkipList<T, CompareFunc>::findNode(const T &value) const {
-  int current_level = head->next.size() - 1;
-  SkipListNode<T>* current = head;
-  do {
-    if (current->data == value) {
-      return current;
-    } else if (current->next[current_level] != tail &&
-               (comp(current->next[current_level]->data, value) ||
-                current->next[current_level]->data == value)) {
-      current = current->next[current_level];
-    } else {
-      current_level--;
-    }
-  } while (current != tail && current_level >= 0);
+  std::cout << "Tail" << std::endl;
+}
+
+template<class T, class CompareFunc, bool kBackLinks>
+typename SkipList<T, CompareFunc, kBackLinks>::Node*
+SkipList<T, CompareFunc, kBackLinks>::findNode(const T &value) const {
+  Node* candidate = lower_bound(value).m_node;
+  if (candidate != tail && !comp(value, candidate->data)) return candidate;
   return nullptr;
 }
 
 #endif  // SKIPLIST_H_
-
-
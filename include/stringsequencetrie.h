@@ -27,52 +27,89 @@
 #ifndef STRINGSEQUENCETRIE_H_
 #define STRINGSEQUENCETRIE_H_
 
+#include <atomic>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include <list>
 #include <string>
+#include <string_view>
 
+#include "sequencechildren.h"
 #include "stringtrie.h"
+#include "tokenpipeline.h"
 
 class StringSequenceTrieNode {
  public:
-  StringSequenceTrieNode(StringTrieNode* string_trie_node,
-                         StringSequenceTrieNode *parent);
+  StringSequenceTrieNode(WordId word, StringSequenceTrieNode *parent);
+  // deletes node and all nodes in the subtrie
+  ~StringSequenceTrieNode();
 
-  bool containsNextWord(StringTrieNode* word) const {
-    return m_next_word.find(word) != m_next_word.end();
+  bool containsNextWord(WordId word) const {
+    return m_next_word.find(word) != nullptr;
   }
 
-  void addChild(StringTrieNode* word) {
-    m_next_word[word] = new StringSequenceTrieNode(word, this);
-    addTimesSeen(1);
+  // records occurences of word following this sequence and returns the
+  // node for the extended sequence, creating it if needed
+  StringSequenceTrieNode* addChild(WordId word, int occurences = 1) {
+    StringSequenceTrieNode*& child = m_next_word.findOrInsert(word);
+    if (child == nullptr) child = new StringSequenceTrieNode(word, this);
+    child->addTimesSeen(occurences);
+    m_next_word.updateTop(child);
+    return child;
   }
 
+  // doesn't update the parent's cached most seen children, prefer addChild
   void addTimesSeen(const int occurences) { m_times_seen += occurences; }
 
   int getTimesSeen() const { return m_times_seen; }
 
-  const StringTrieNode* getWordNode() const { return m_trie_word_node; }
+  WordId getWordId() const { return m_word; }
 
-  const StringSequenceTrieNode* getNextSequenceNode(StringTrieNode* next_word) {
-      return containsNextWord(next_word) ? m_next_word[next_word] : nullptr;
+  const StringSequenceTrieNode* getNextSequenceNode(WordId next_word) const {
+    return m_next_word.find(next_word);
   }
 
+  const SequenceChildren& getChildren() const { return m_next_word; }
+
+  // number of heap bytes used by this node and its subtrie
+  std::size_t memoryUsage() const;
+
+  // deletes the children seen fewer than min_count times together with
+  // their subtries, returns the number of nodes deleted
+  std::size_t prune(int min_count);
+
   friend class StringSequenceTrie;
+  friend class SequenceLanguageModel;
+  friend class SequenceGenerator;
 
  protected:
+  // deletes node and its subtrie, returns the number of nodes deleted
+  static std::size_t deleteSubtrie(StringSequenceTrieNode* node);
+
   // current word in the sequence
-  const StringTrieNode* m_trie_word_node;
+  const WordId m_word;
+
+  // number of times the sequence has been seen
+  int m_times_seen;
+
+  // filled in by StringSequenceTrie::updateContinuationCounts
+  // sum of the times seen of all children, the number of times the
+  // sequence was followed by another word
+  int m_successor_count;
+  // number of distinct (previous word, next word) pairs seen around the
+  // sequence, used as the denominator of lower order Kneser-Ney estimates
+  int m_continuation_count;
+  // number of next words w with a word seen before the sequence and w,
+  // the lower order Kneser-Ney backoff weight's count
+  int m_continued_count;
 
   // pointer to previous word in sequence
   const StringSequenceTrieNode* m_parent;
 
-  // hash table of all possible next words
-  std::unordered_map<StringTrieNode*, StringSequenceTrieNode*> m_next_word;
-
-  // number of times the sequence has been seen
-  int m_times_seen;
+  // all possible next words, keyed by word id
+  SequenceChildren m_next_word;
 };
 
 
@@ -80,14 +117,17 @@ class StringSequenceTrie {
  public:
 
   StringSequenceTrie();
+  ~StringSequenceTrie();
+
+  StringSequenceTrie(const StringSequenceTrie&) = delete;
+  StringSequenceTrie& operator=(const StringSequenceTrie&) = delete;
 
   class SequenceCriteria {
    public:
     SequenceCriteria(){}
-    void setStartingSequence(std::string starting_sequence);
+    void setStartingSequence(std::string_view starting_sequence);
 
     std::string m_starting_sequence = "";
-    // std::unordered_set<std::string> m_black_list_words;
     int m_length_max_count = 3;
     int m_length_min_count = 2;
     int m_branching_factor = 50;
@@ -96,13 +136,75 @@ class StringSequenceTrie {
   };
 
   // add sequence of strings separated by spaces to trie
-  void addSequence(const std::string &sequence);
+  void addSequence(std::string_view sequence);
 
-  // add sequence of strings from vector to trie
+  // add every window of window_size consecutive strings from vector to trie
   void addSequence(const std::vector<std::string> &sequence,
                    int window_size = 5);
 
-  std::string getNextWord(std::string &sequence);
+  // same as above for count words that have already been split, e.g.
+  // views into a larger text
+  void addSequence(const std::string_view* words, std::size_t count,
+                   int window_size = 5);
+
+  // returns the word most often seen after sequence, backing off to shorter
+  // sequences if it has never been seen. returns "" for an empty trie
+  std::string getNextWord(std::string_view sequence) const;
+
+  // same as getNextWord, returning the word's id or kNoWord. Doesn't
+  // allocate
+  WordId getNextWordId(std::string_view sequence) const;
+
+  // fills next_words with up to limit of the words most often seen after the
+  // context, most frequent first. If the context has never been followed by
+  // a word, its oldest words are dropped until one has (down to no context,
+  // which gives the most frequent words overall). Limits up to
+  // SequenceChildren::kTopChildren don't need to sort the children.
+  // returns the number of context words that were used
+  int predictNextWords(const WordId* context, int context_length,
+                       std::vector<WordId>* next_words,
+                       int limit = SequenceChildren::kTopChildren) const;
+
+  // same as predictNextWords for the words seen right before the context,
+  // read from the backward trie. Backs off by dropping the newest words
+  int predictPreviousWords(const WordId* context, int context_length,
+                           std::vector<WordId>* previous_words,
+                           int limit = SequenceChildren::kTopChildren) const;
+
+  // fills gap_words with up to limit of the words most often seen between
+  // left and right (e.g. "the ___ of"), best first, and their scores if
+  // scores isn't nullptr. Candidates are the words both seen after left in
+  // the forward trie and before right in the backward trie. When the whole
+  // sequence fits in the window a candidate scores the times it was seen,
+  // otherwise count(left w) * count(w right) / count(w). If no word fits
+  // both sides the word farthest from the gap on the longer side is
+  // dropped, ending in predictNextWords / predictPreviousWords once a side
+  // is empty. returns the number of context words that were used
+  int predictGapWords(const WordId* left, int left_length,
+                      const WordId* right, int right_length,
+                      std::vector<WordId>* gap_words,
+                      int limit = SequenceChildren::kTopChildren,
+                      std::vector<double>* scores = nullptr) const;
+
+  // returns the word most often seen right before sequence, "" if none
+  std::string getPreviousWord(std::string_view sequence) const;
+
+  // returns the word that best fills the gap between left and right
+  std::string getGapWord(std::string_view left, std::string_view right) const;
+
+  // returns the id of word, kNoWord if it has never been added
+  WordId getWordId(std::string_view word) const;
+
+  // returns the string for a word id
+  std::string getWord(WordId word) const;
+
+  // splits sequence on spaces and looks up each word, unknown words are
+  // returned as kNoWord
+  std::vector<WordId> getWordIds(std::string_view sequence) const;
+
+  // returns the node for a sequence of words separated by spaces, nullptr
+  // if it has never been seen. Doesn't allocate
+  StringSequenceTrieNode* getNode(std::string_view sequence) const;
 
   // returns a vector of StringSequenceTrieNode pointers ordered by the number
   // of times that node (the sequence ending with the word contained in that
@@ -110,8 +212,11 @@ class StringSequenceTrie {
   // seqence_length_upper_limit - max number of words in the sequence
   // seqence_length_lower_limit - minimum number of words in the sequence
   // branching_factor - number of possible next words following the current word
+  // limit - max number of sequences to return, 0 for all of them. Only the
+  // best limit sequences are kept while searching, and subtries that can't
+  // beat the worst of them are skipped
   std::vector<StringSequenceTrieNode*> getOrderedWords(
-      const SequenceCriteria &criteria) const;
+      const SequenceCriteria &criteria, int limit = 0) const;
 
   void printOrderedWords(const SequenceCriteria &criteria) const;
 
@@ -120,35 +225,178 @@ class StringSequenceTrie {
   // returns a sequence of strings one string at a time from the last node;
   std::string buildSequenceFromFinalNode(const StringSequenceTrieNode* current) const;
 
-  void writeToFile(std::string filename = "trieFile.txt") const;
+  // saves the vocabulary and both tries in a compact binary format: each
+  // word once, then every node as a varint delta from its previous
+  // sibling's word id, its count and its number of children, in preorder.
+  // returns false if the file couldn't be written
+  bool writeToFile(std::string filename = "trieFile.txt") const;
 
-  void readFromFile(std::string filename = "trieFile.txt");
+  // maps a file saved by writeToFile and adds its words and sequence counts
+  // to this trie. returns false if the file couldn't be read or is
+  // malformed, in which case part of it may already have been added
+  bool readFromFile(std::string filename = "trieFile.txt");
 
+  // splits text into words with the token pipeline and adds every window
+  // of window_size consecutive words, none spanning a break
+  void addText(std::string_view text, int window_size = 5);
+
+  // adds the text of books/file_name as addText does
   void loadTextFile(std::string file_name = "", int window_size = 5);
 
+  // loads several text files in parallel. Files are cut into chunks at
+  // sentence boundaries, and thread_count workers (one per core when 0)
+  // count the chunks into their own forward and backward tries, which are
+  // then summed into this trie. Words are shared through one dictionary.
+  void loadTextFiles(const std::vector<std::string> &file_names,
+                     int window_size = 5, int thread_count = 0);
+
+  // decides which words of loaded texts are counted and where sequences
+  // stop, applied by addText, loadTextFile and loadTextFiles
+  TokenPipeline &getTokenPipeline() { return m_token_pipeline; }
+  const TokenPipeline &getTokenPipeline() const { return m_token_pipeline; }
+
+  // returns the number of sequence nodes in the forward and backward tries
+  std::size_t getNumberNodes() const;
+
+  // returns the number of distinct words
+  std::size_t getNumberUniqueWords() const { return m_vocabulary.size(); }
+
+  // returns the longest sequence stored, the order of the n-gram model
+  int getWindowSize() const { return m_window_size; }
+
+  // recomputes the successor and continuation counts cached on the forward
+  // trie's nodes, must be called before scoring with a SequenceLanguageModel
+  // after the trie has changed
+  void updateContinuationCounts();
+
+  // returns the number of heap bytes used by the forward and backward tries
+  std::size_t memoryUsage() const;
+
+  // removes every sequence seen fewer than min_count times from both tries
+  // and releases its memory. words stay in the vocabulary. returns the
+  // number of nodes removed
+  std::size_t prune(int min_count);
+
+  // prunes with the smallest min_count that brings memoryUsage() down to
+  // at most bytes, and returns that min_count (0 if nothing was pruned)
+  int compactToBudget(std::size_t bytes);
+
+  // caps memoryUsage() while loadTextFile and addSequence are adding
+  // sequences, 0 for no limit. once the cap is reached the rarest
+  // sequences are pruned until the tries are down to half of it
+  void setMemoryBudget(std::size_t bytes) { m_memory_budget = bytes; }
+
  protected:
-  // returns a node pointing to the last node in the sequence
-  StringSequenceTrieNode* getNode(const std::string &sequence) const;
+  // Sliding window over a stream of word ids. Each pushed word extends the
+  // forward sequences starting at the previous window_size - 1 words, and
+  // adds the backward sequence of up to window_size words ending with it.
+  // Forward sequences are grown through cursors kept on their last node, so
+  // every (start, length) pair is counted exactly once and no words are
+  // re-read or re-looked up as the window slides.
+  class SequenceWindow {
+   public:
+    SequenceWindow(StringSequenceTrieNode* forward_head,
+                   StringSequenceTrieNode* backward_head, int window_size);
+
+    void push(WordId word);
+
+    // forgets the words seen so far, so no sequence spans the reset. must
+    // be called if nodes the window is on may have been deleted
+    void reset() { m_filled = 0; }
+
+    // number of nodes push has created since the count was last cleared
+    std::size_t newNodes() const { return m_new_nodes; }
+    void clearNewNodes() { m_new_nodes = 0; }
+
+   private:
+    StringSequenceTrieNode* m_forward_head;
+    StringSequenceTrieNode* m_backward_head;
+    // ring buffers indexed by the position of the word that starts the
+    // forward sequence / the word itself
+    std::vector<StringSequenceTrieNode*> m_cursors;
+    std::vector<WordId> m_words;
+    std::size_t m_next;
+    std::size_t m_filled;
+    std::size_t m_new_nodes;
+  };
+
+  // measures the tries once window has created enough nodes that they may
+  // have gone over m_memory_budget, compacting them if they have. returns
+  // the number of new nodes the window can add before the next check
+  std::size_t enforceMemoryBudget(SequenceWindow *window);
+
+  // pushes words from the token pipeline through window, restarting it at
+  // every break
+  void pushWords(const std::vector<std::string_view> &words,
+                 SequenceWindow *window, std::size_t *budget_check);
+
+  // adds word to m_trie and returns its id, assigning a new id the first
+  // time a word is seen. returns kNoWord for an empty word
+  WordId addWord(std::string_view word, int occurences = 1);
+
+  // follows words from head, returns nullptr if the sequence isn't there
+  const StringSequenceTrieNode* findSequence(const StringSequenceTrieNode* head,
+      const WordId* words, int length) const;
+
+  // follows words from the backward head in reverse order, giving the node
+  // whose children are the words seen before the sequence
+  const StringSequenceTrieNode* findSequenceBackward(const WordId* words,
+                                                     int length) const;
+
+  // appends up to limit of node's most seen children, most seen first
+  void getMostSeenChildren(const StringSequenceTrieNode* node,
+                           std::vector<WordId>* words, int limit) const;
 
-  void addSequenceHelper(const std::string &sequence,
-      StringSequenceTrieNode *current_seq_node, std::size_t starting_pos = 0);
+  // follows the words of sequence from head, returns nullptr if the
+  // sequence isn't there
+  const StringSequenceTrieNode* findSequence(const StringSequenceTrieNode* head,
+      std::string_view sequence) const;
 
-  void addSequenceBackwardHelper(const std::string &sequence,
-      StringSequenceTrieNode *current_seq_node, std::size_t starting_pos = 0);
+  // pushes every word from begin to end through a window of window_size
+  template <typename Iterator>
+  void addSequenceHelper(Iterator begin, Iterator end, int window_size);
+
+  // state shared by the recursive calls of getOrderedWordsHelper
+  struct OrderedWordsSearch;
 
   void getOrderedWordsHelper(const StringSequenceTrieNode* current_node,
-      std::vector<StringSequenceTrieNode *> *sequences,
-      const SequenceCriteria &criteria, int current_sequence_length) const;
+      OrderedWordsSearch *search, int current_sequence_length) const;
 
  private:
-  void readFromFileHelper(std::ifstream &infile,
-      StringSequenceTrieNode *current_seq_node);
+  // per thread tries and word cache used by loadTextFiles
+  struct SequenceWorker;
+
+  // counts chunks taken from next_chunk into the worker's tries until none
+  // are left
+  // chunks are views of the loaded texts, each starting at a sentence
+  void countChunks(SequenceWorker *worker,
+                   const std::vector<std::string_view> &chunks,
+                   std::atomic<std::size_t> *next_chunk, int window_size);
+
+  // adds word to the shared dictionary without counting an occurence,
+  // may be called from several workers at once
+  WordId addWordShared(const std::string &word);
+
+  // sums the counts of from's subtrie into into's, moving over any
+  // sequences into has not seen. from's children are consumed
+  void mergeSequenceNode(StringSequenceTrieNode *into,
+                         StringSequenceTrieNode *from);
+
+  // encoder and decoder state for writeToFile and readFromFile
+  struct SequenceFileWriter;
+  struct SequenceFileReader;
+
+  bool readFromFileHelper(SequenceFileReader *reader,
+      StringSequenceTrieNode *current_seq_node, int depth);
 
-  void writeToFileHelper(std::ofstream &outfile,
-      const StringSequenceTrieNode *current_node) const;
+  void writeToFileHelper(SequenceFileWriter *writer,
+      const StringSequenceTrieNode *current_node, int depth) const;
 
   StringTrie* m_trie;
 
+  // final StringTrieNode of each word, indexed by word id
+  std::vector<StringTrieNode*> m_vocabulary;
+
   StringSequenceTrieNode* m_seq_head;
 
   StringSequenceTrieNode* m_seq_backward_head;
@@ -156,6 +404,17 @@ class StringSequenceTrie {
   int m_total_words;
 
   int m_window_size;
+
+  // bytes the tries may use while adding sequences, 0 for no limit
+  std::size_t m_memory_budget;
+
+  TokenPipeline m_token_pipeline;
+
+  friend class SequenceLanguageModel;
+  friend class SequenceGenerator;
+
+  // guards m_trie and m_vocabulary while loadTextFiles is running
+  std::mutex m_vocabulary_mutex;
 };
 
 
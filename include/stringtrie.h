@@ -26,7 +26,9 @@
 
 #ifndef STRINGTRIE_H_
 #define STRINGTRIE_H_
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <vector>
 #include <queue>
@@ -57,10 +59,13 @@ class StringTrieNode {
   }
 
   friend class StringTrie;
+  friend class StringSequenceTrie;
 
  protected:
   const char data;
   bool is_a_word;
+  // id given to the word by a StringSequenceTrie, UINT32_MAX if it has none
+  std::uint32_t word_id;
   StringTrieNode* parent;
   // hash table containing pointers to all suffixes
   std::map<char, StringTrieNode*> m_paths;
@@ -79,7 +84,7 @@ class StringTrie {
   void resetTrie();
 
   // adds word to trie
-  void addWord(const std::string &word);
+  void addWord(std::string_view word);
 
   // removes word from trie, deleting any node that isn't the prefix
   // of another another word
@@ -140,7 +145,11 @@ class StringTrie {
   // returns StringTrieNode pointer pointing to the final node
   // corresponding to the last node (character) of the string
   // returns nullptr if word is not in trie
-  StringTrieNode* getNode(const std::string &word);
+  StringTrieNode* getNode(std::string_view word);
+
+  // adds occurences of word to trie and returns the final node of the word
+  // returns nullptr if word is empty
+  StringTrieNode* insertWord(std::string_view word, int occurences = 1);
 
  private:
   // prints all words in subtree,
@@ -0,0 +1,98 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+#ifndef TOKENPIPELINE_H_
+#define TOKENPIPELINE_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Decides which words of a text reach a trie, and where the sequences
+// counted from them must stop. Text is split into words by CorpusReader,
+// then every word is run once through the pipeline: stop words are left
+// out, black listed words and sentence ends break the sequence, and custom
+// stages added with addStage run last, in order. Breaks are handed on as
+// empty words, so no n-gram is counted across them.
+class TokenPipeline {
+ public:
+  // what a stage does with a word
+  enum Action {
+    kKeepWord,    // passed on to the next stage
+    kSkipWord,    // left out, the words either side become neighbours
+    kEndSequence  // left out, and no sequence spans it
+  };
+
+  // a stage may also narrow word to part of itself, e.g. to drop a suffix
+  typedef std::function<Action(std::string_view* word)> Stage;
+
+  // splits sentences and knows common English title abbreviations
+  TokenPipeline();
+
+  // sequences stop at the end of every sentence and paragraph when on
+  void setSplitSentences(bool split) { m_split_sentences = split; }
+  bool getSplitSentences() const { return m_split_sentences; }
+
+  // words ending with a period that don't end a sentence, e.g. "mr"
+  void addAbbreviation(std::string_view word);
+
+  void addStopWord(std::string_view word);
+
+  void addBlackListWord(std::string_view word);
+
+  void addStage(const Stage &stage) { m_stages.push_back(stage); }
+
+  // appends the words of text that pass the pipeline to words, with an
+  // empty view wherever a sequence has to end. buffer is used as by
+  // CorpusReader::tokenize
+  void tokenize(std::string_view text, std::vector<std::string_view>* words,
+                std::string* buffer) const;
+
+  // true if word marks the end of a sequence
+  static bool isBreak(std::string_view word) { return word.empty(); }
+
+ private:
+  // runs word through the word lists and stages
+  Action apply(std::string_view* word, bool* abbreviation) const;
+
+  void addWord(std::string_view word, Action action, bool abbreviation);
+
+  struct WordRule {
+    Action action;
+    bool abbreviation;
+  };
+
+  bool m_split_sentences;
+  // stop words, black listed words and abbreviations, all cleaned
+  std::unordered_map<std::string, WordRule> m_words;
+  // no word longer than this is in m_words, so it isn't looked up
+  std::size_t m_longest_word;
+  std::vector<Stage> m_stages;
+};
+
+#endif  // TOKENPIPELINE_H_
@@ -0,0 +1,417 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+#ifndef UNROLLEDLINKEDLIST_H_
+#define UNROLLEDLINKEDLIST_H_
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+///////////////////////////////////////////////////////////////////////////////
+// DECLARATIONS
+///////////////////////////////////////////////////////////////////////////////
+
+// node holding up to kCapacity consecutive elements of the list, sized so
+// a node fills roughly kNodeBytes (four cache lines)
+template<class T>
+struct UnrolledListNode {
+  static const int kNodeBytes = 256;
+  static const int kHeaderBytes = 2 * sizeof(void*) + sizeof(int);
+  static const int kCapacity = (kNodeBytes - kHeaderBytes) / sizeof(T) < 4
+      ? 4 : (kNodeBytes - kHeaderBytes) / sizeof(T);
+
+  UnrolledListNode<T>* next;
+  UnrolledListNode<T>* prev;
+  // number of elements used, from the start of items
+  int count;
+  T items[kCapacity];
+
+  UnrolledListNode();
+};
+
+// Same interface as LinkedList, but each node stores a small array of
+// elements instead of one, so traversals touch a few cache lines per
+// kCapacity elements rather than one node per element, and most inserts
+// don't allocate. A full node is split in two on insert, and a node left
+// less than a quarter full is merged with its successor when they fit in
+// one. T must be default constructible.
+template<class T>
+class UnrolledLinkedList {
+ public:
+  // default constructor
+  UnrolledLinkedList();
+  // copy constructor
+  UnrolledLinkedList(const UnrolledLinkedList& other_list);
+  // destructor
+  ~UnrolledLinkedList();
+  // assignment operator
+  UnrolledLinkedList& operator=(const UnrolledLinkedList& other_list);
+
+  // insert value at start of list
+  void insertStart(const T& value);
+  // insert value at end of list
+  void insertEnd(const T& value);
+  // insert value at specified index
+  void insertAt(const T& value, const int index);
+
+  // returns true if value is in list
+  bool contains(const T& value) const;
+
+  // returns first element in the list
+  inline T getFirst() const;
+  // returns last element in the list
+  inline T getLast() const;
+  // returns element at specified index
+  T getItemAt(const int index) const;
+
+  // removes first element from the list
+  T removeFirst();
+  // removes last element from the list
+  T removeLast();
+  // removes element at specified index
+  T removeAt(const int index);
+
+  //returns number of elements in list
+  inline int getLength() const;
+
+  // number of nodes allocated
+  inline int getNodeCount() const;
+
+  // removes every element
+  void clear();
+
+  // prints list in order in the form,
+  // "Head -> data -> data -> data...."
+  void print() const;
+
+ private:
+  typedef UnrolledListNode<T> Node;
+
+  // finds the node holding index, leaving index as the offset within it
+  Node* findNode(int* index) const;
+
+  // creates an empty node after node, or at the start if node is nullptr
+  Node* insertNodeAfter(Node* node);
+
+  // unlinks and deletes node
+  void removeNode(Node* node);
+
+  // inserts value at offset of a node that isn't full
+  void insertInNode(Node* node, int offset, const T& value);
+
+  // removes the element at offset of node, merging or deleting the node
+  // if it gets too empty
+  T removeFromNode(Node* node, int offset);
+
+  void copyFrom(const UnrolledLinkedList& other_list);
+
+  Node* head;
+  Node* tail;
+  int length;
+  int node_count;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// DEFINITIONS
+///////////////////////////////////////////////////////////////////////////////
+template<class T>
+UnrolledListNode<T>::UnrolledListNode() {
+  next = nullptr;
+  prev = nullptr;
+  count = 0;
+}
+
+// initializes empty UnrolledLinkedList
+template<class T>
+UnrolledLinkedList<T>::UnrolledLinkedList() {
+  head = nullptr;
+  tail = nullptr;
+  length = 0;
+  node_count = 0;
+}
+
+// initializes new list as a deep copy of existing list
+template<class T>
+UnrolledLinkedList<T>::UnrolledLinkedList(const UnrolledLinkedList& other_list) {
+  head = nullptr;
+  tail = nullptr;
+  length = 0;
+  node_count = 0;
+  copyFrom(other_list);
+}
+
+// releases memory allocated by UnrolledLinkedList
+template<class T>
+UnrolledLinkedList<T>::~UnrolledLinkedList() {
+  clear();
+}
+
+template<class T>
+UnrolledLinkedList<T>& UnrolledLinkedList<T>::operator=(
+    const UnrolledLinkedList& other_list) {
+  if (this != &other_list) {
+    clear();
+    copyFrom(other_list);
+  }
+  return *this;
+}
+
+// appends copies of other_list's nodes, packed as they are
+template<class T>
+void UnrolledLinkedList<T>::copyFrom(const UnrolledLinkedList& other_list) {
+  for (Node* other_node = other_list.head; other_node != nullptr;
+       other_node = other_node->next) {
+    Node* node = insertNodeAfter(tail);
+    std::copy(other_node->items, other_node->items + other_node->count,
+              node->items);
+    node->count = other_node->count;
+    length += other_node->count;
+  }
+}
+
+template<class T>
+void UnrolledLinkedList<T>::clear() {
+  while (head != nullptr) {
+    Node* next = head->next;
+    delete head;
+    head = next;
+  }
+  tail = nullptr;
+  length = 0;
+  node_count = 0;
+}
+
+template<class T>
+typename UnrolledLinkedList<T>::Node* UnrolledLinkedList<T>::insertNodeAfter(
+    Node* node) {
+  Node* temp = new Node();
+  temp->prev = node;
+  temp->next = node == nullptr ? head : node->next;
+  if (temp->next != nullptr) temp->next->prev = temp;
+  else tail = temp;
+  if (node != nullptr) node->next = temp;
+  else head = temp;
+  node_count++;
+  return temp;
+}
+
+template<class T>
+void UnrolledLinkedList<T>::removeNode(Node* node) {
+  if (node->prev != nullptr) node->prev->next = node->next;
+  else head = node->next;
+  if (node->next != nullptr) node->next->prev = node->prev;
+  else tail = node->prev;
+  delete node;
+  node_count--;
+}
+
+// walks nodes from the nearer end, an index equal to length gives the
+// position after the last element
+template<class T>
+typename UnrolledLinkedList<T>::Node* UnrolledLinkedList<T>::findNode(
+    int* index) const {
+  if (*index < length / 2) {
+    Node* current = head;
+    while (*index >= current->count) {
+      *index -= current->count;
+      current = current->next;
+    }
+    return current;
+  }
+  Node* current = tail;
+  int offset = length - *index;
+  while (offset > current->count) {
+    offset -= current->count;
+    current = current->prev;
+  }
+  *index = current->count - offset;
+  return current;
+}
+
+template<class T>
+void UnrolledLinkedList<T>::insertInNode(Node* node, int offset, const T& value) {
+  std::move_backward(node->items + offset, node->items + node->count,
+                     node->items + node->count + 1);
+  node->items[offset] = value;
+  node->count++;
+  length++;
+}
+
+// insert item at start of list
+template<class T>
+void UnrolledLinkedList<T>::insertStart(const T& value) {
+  // a full first node gets a new node in front rather than being split,
+  // so repeated inserts at the start fill nodes completely
+  if (head == nullptr || head->count == Node::kCapacity) insertNodeAfter(nullptr);
+  insertInNode(head, 0, value);
+}
+
+// insert item at end of list
+template<class T>
+void UnrolledLinkedList<T>::insertEnd(const T& value) {
+  if (tail == nullptr || tail->count == Node::kCapacity) insertNodeAfter(tail);
+  insertInNode(tail, tail->count, value);
+}
+
+// insert at certain length into list
+// adds to beginning if length is 0
+// adds to end if index is greater than length of list
+template<class T>
+void UnrolledLinkedList<T>::insertAt(const T& value, const int index) {
+  if (index >= length) {
+    insertEnd(value);
+  } else if (index <= 0) {
+    insertStart(value);
+  } else {
+    int offset = index;
+    Node* node = findNode(&offset);
+    if (node->count == Node::kCapacity) {
+      // move the back half to a new node
+      const int half = Node::kCapacity / 2;
+      Node* back = insertNodeAfter(node);
+      std::move(node->items + half, node->items + node->count, back->items);
+      std::fill(node->items + half, node->items + node->count, T());
+      back->count = node->count - half;
+      node->count = half;
+      if (offset > half) {
+        node = back;
+        offset -= half;
+      }
+    }
+    insertInNode(node, offset, value);
+  }
+}
+
+template<class T>
+T UnrolledLinkedList<T>::removeFromNode(Node* node, int offset) {
+  T data(std::move(node->items[offset]));
+  std::move(node->items + offset + 1, node->items + node->count,
+            node->items + offset);
+  node->count--;
+  // release whatever the vacated slot held
+  node->items[node->count] = T();
+  length--;
+
+  if (node->count == 0) {
+    removeNode(node);
+  } else if (node->count < Node::kCapacity / 4 && node->next != nullptr &&
+             node->count + node->next->count <= Node::kCapacity) {
+    Node* next = node->next;
+    std::move(next->items, next->items + next->count, node->items + node->count);
+    node->count += next->count;
+    removeNode(next);
+  }
+  return data;
+}
+
+// removes first item from list
+// returns copy of item that was deleted
+template<class T>
+T UnrolledLinkedList<T>::removeFirst() {
+  if (length == 0) return T();
+  return removeFromNode(head, 0);
+}
+
+// removes last item from list
+// returns copy of item that was deleted
+template<class T>
+T UnrolledLinkedList<T>::removeLast() {
+  if (length == 0) return T();
+  return removeFromNode(tail, tail->count - 1);
+}
+
+// remove element at index
+// removes the last element if the index is greater than the length of the list
+template<class T>
+T UnrolledLinkedList<T>::removeAt(const int index) {
+  if (index >= length) {
+    return removeLast();
+  } else if (index <= 0) {
+    return removeFirst();
+  } else {
+    int offset = index;
+    Node* node = findNode(&offset);
+    return removeFromNode(node, offset);
+  }
+}
+
+template<class T>
+bool UnrolledLinkedList<T>::contains(const T& value) const {
+  for (Node* current = head; current != nullptr; current = current->next) {
+    if (std::find(current->items, current->items + current->count, value) !=
+        current->items + current->count) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template<class T>
+T UnrolledLinkedList<T>::getFirst() const {
+  return length == 0 ? T() : head->items[0];
+}
+
+template<class T>
+T UnrolledLinkedList<T>::getLast() const {
+  return length == 0 ? T() : tail->items[tail->count - 1];
+}
+
+template<class T>
+T UnrolledLinkedList<T>::getItemAt(const int index) const {
+  if (index >= length) {
+    return getLast();
+  } else if (index <= 0) {
+    return getFirst();
+  } else {
+    int offset = index;
+    Node* node = findNode(&offset);
+    return node->items[offset];
+  }
+}
+
+template<class T>
+int UnrolledLinkedList<T>::getLength() const {
+  return length;
+}
+
+template<class T>
+int UnrolledLinkedList<T>::getNodeCount() const {
+  return node_count;
+}
+
+// prints list in order in the form,
+// "Head -> data -> data -> data...."
+template<class T>
+void UnrolledLinkedList<T>::print() const {
+  std::cout << "Head";
+  for (Node* current = head; current != nullptr; current = current->next) {
+    for (int i = 0; i < current->count; i++)
+      std::cout << " -> " << current->items[i];
+  }
+  std::cout << std::endl;
+}
+
+#endif  // UNROLLEDLINKEDLIST_H_
@@ -0,0 +1,120 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+#include "concurrentsequencetrie.h"
+
+#include <thread>
+
+namespace {
+
+// spreads threads over the reader slots
+int readerSlot(int slots) {
+  static std::atomic<int> next_slot(0);
+  thread_local int slot = next_slot.fetch_add(1) % slots;
+  return slot;
+}
+
+}  // namespace
+
+ConcurrentSequenceTrie::Snapshot::Snapshot(Snapshot &&other)
+    : m_readers(other.m_readers), m_trie(other.m_trie) {
+  other.m_readers = nullptr;
+}
+
+ConcurrentSequenceTrie::Snapshot::~Snapshot() {
+  if (m_readers != nullptr) m_readers->fetch_sub(1);
+}
+
+ConcurrentSequenceTrie::ConcurrentSequenceTrie()
+    : m_epoch(0), m_published(0), m_version(0) {
+  for (ReaderSlot &slot : m_slots) {
+    slot.readers[0].store(0);
+    slot.readers[1].store(0);
+  }
+}
+
+ConcurrentSequenceTrie::Snapshot ConcurrentSequenceTrie::read() const {
+  // announce before reading which trie is published, so a writer that
+  // swaps it afterwards will wait for us
+  std::atomic<int>* readers =
+      &m_slots[readerSlot(kReaderSlots)].readers[m_epoch.load()];
+  readers->fetch_add(1);
+  return Snapshot(readers, &m_tries[m_published.load()]);
+}
+
+void ConcurrentSequenceTrie::update(
+    const std::function<void(StringSequenceTrie*)> &change) {
+  std::lock_guard<std::mutex> lock(m_writer_mutex);
+  change(&m_tries[1 - m_published.load()]);
+  m_pending.push_back(change);
+}
+
+void ConcurrentSequenceTrie::addSequence(
+    const std::vector<std::string> &sequence, int window_size) {
+  update([sequence, window_size](StringSequenceTrie* trie) {
+    trie->addSequence(sequence, window_size);
+  });
+}
+
+void ConcurrentSequenceTrie::addText(const std::string &text, int window_size) {
+  update([text, window_size](StringSequenceTrie* trie) {
+    trie->addText(text, window_size);
+  });
+}
+
+void ConcurrentSequenceTrie::loadTextFile(const std::string &file_name,
+                                          int window_size) {
+  update([file_name, window_size](StringSequenceTrie* trie) {
+    trie->loadTextFile(file_name, window_size);
+  });
+}
+
+bool ConcurrentSequenceTrie::hasReaders(int epoch) const {
+  for (const ReaderSlot &slot : m_slots)
+    if (slot.readers[epoch].load() != 0) return true;
+  return false;
+}
+
+void ConcurrentSequenceTrie::waitForReaders(int epoch) const {
+  while (hasReaders(epoch)) std::this_thread::yield();
+}
+
+std::size_t ConcurrentSequenceTrie::publish() {
+  std::lock_guard<std::mutex> lock(m_writer_mutex);
+  const int published = m_published.load();
+  m_published.store(1 - published);
+
+  // readers may have read the old index in either epoch. new readers are
+  // moved to the other epoch once it has drained, then the old one is
+  // waited for, after which nobody can still be on the old trie
+  const int epoch = m_epoch.load();
+  waitForReaders(1 - epoch);
+  m_epoch.store(1 - epoch);
+  waitForReaders(epoch);
+
+  for (const auto &change : m_pending) change(&m_tries[published]);
+  m_pending.clear();
+  return m_version.fetch_add(1) + 1;
+}
@@ -0,0 +1,171 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+
+#include "corpusreader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+
+#include "tokenpipeline.h"
+
+namespace {
+
+// what the tokenizer does with each byte
+enum CharClass : std::uint8_t {
+  kSeparator,  // ends a word
+  kKeep,       // copied as is
+  kDrop,       // punctuation, removed
+  kFold        // upper case, lower cased
+};
+
+struct CharTable {
+  CharTable() {
+    for (int c = 0; c < 256; c++) {
+      if (std::isspace(c)) classes[c] = kSeparator;
+      else if (std::ispunct(c) && c != '.') classes[c] = kDrop;
+      else if (std::isupper(c)) classes[c] = kFold;
+      else classes[c] = kKeep;
+      folded[c] = static_cast<char>(std::tolower(c));
+    }
+  }
+
+  CharClass classes[256];
+  char folded[256];
+};
+
+const CharTable kCharTable;
+
+inline CharClass classify(char c) {
+  return kCharTable.classes[static_cast<unsigned char>(c)];
+}
+
+// characters that may follow the punctuation ending a sentence
+inline bool isCloser(char c) {
+  return c == '"' || c == '\'' || c == ')' || c == ']' || c == '_';
+}
+
+inline bool isTerminal(char c) {
+  return c == '.' || c == '!' || c == '?';
+}
+
+// true for lines like "-----" or "* * *" that separate pages and chapters
+inline bool isRule(const char* begin, const char* end) {
+  if (end - begin < 3) return false;
+  for (const char* c = begin; c < end; c++)
+    if (*c != *begin || (*c != '-' && *c != '*' && *c != '=' && *c != '_'))
+      return false;
+  return true;
+}
+
+// appends a sentence break unless words already ends with one
+inline void addBreak(std::vector<std::string_view>* words) {
+  if (words->empty() || !words->back().empty()) words->emplace_back();
+}
+
+}  // namespace
+
+CorpusReader::CorpusReader(const std::string &file_name)
+    : m_file(file_name), m_position(0) {}
+
+bool CorpusReader::nextBatch(std::vector<std::string_view>* words,
+                             const TokenPipeline* pipeline) {
+  words->clear();
+  std::string_view text = getText();
+  while (words->empty() && m_position < text.size()) {
+    // batches end after a run of separators so no word or blank line is
+    // split between two
+    std::size_t end = std::min(m_position + kBatchBytes, text.size());
+    while (end < text.size() && classify(text[end]) != kSeparator) end++;
+    while (end < text.size() && classify(text[end]) == kSeparator) end++;
+    std::string_view batch = text.substr(m_position, end - m_position);
+    if (pipeline != nullptr) pipeline->tokenize(batch, words, &m_buffer);
+    else tokenize(batch, words, &m_buffer);
+    m_position = end;
+  }
+  return !words->empty();
+}
+
+void CorpusReader::tokenize(std::string_view text,
+                            std::vector<std::string_view>* words,
+                            std::string* buffer, bool split_sentences) {
+  // cleaning never lengthens a word, so the buffer is never reallocated
+  // while views into it are held
+  buffer->resize(text.size());
+  char* out = &(*buffer)[0];
+
+  const char* position = text.data();
+  const char* const end = position + text.size();
+  while (position < end) {
+    int line_breaks = 0;
+    for (; position < end && classify(*position) == kSeparator; position++)
+      line_breaks += *position == '\n';
+    // a blank line ends a paragraph, and so a sentence
+    if (split_sentences && line_breaks > 1) addBreak(words);
+    const char* word_begin = position;
+    bool clean = true;
+    for (; position < end; position++) {
+      CharClass char_class = classify(*position);
+      if (char_class == kSeparator) break;
+      clean &= char_class == kKeep;
+    }
+    if (word_begin == position) break;
+
+    std::string_view word;
+    if (clean) {
+      word = std::string_view(word_begin, position - word_begin);
+    } else {
+      char* cleaned = out;
+      for (const char* c = word_begin; c < position; c++) {
+        CharClass char_class = classify(*c);
+        if (char_class != kDrop) *out++ = kCharTable.folded[static_cast<unsigned char>(*c)];
+      }
+      word = std::string_view(cleaned, out - cleaned);
+    }
+
+    bool sentence_end = false;
+    if (split_sentences) {
+      const char* last = position;
+      while (last > word_begin && isCloser(last[-1])) last--;
+      sentence_end = (last > word_begin && isTerminal(last[-1])) ||
+                     (word.empty() && isRule(word_begin, position));
+      while (sentence_end && !word.empty() && word.back() == '.')
+        word.remove_suffix(1);
+    }
+    if (!word.empty()) words->push_back(word);
+    if (sentence_end) addBreak(words);
+  }
+}
+
+void CorpusReader::cleanWord(std::string* word) {
+  std::size_t length = 0;
+  for (char c : *word) {
+    CharClass char_class = classify(c);
+    if (char_class != kDrop && char_class != kSeparator)
+      (*word)[length++] = kCharTable.folded[static_cast<unsigned char>(c)];
+  }
+  word->resize(length);
+}
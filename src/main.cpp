@@ -27,21 +27,37 @@
 #include <iostream>
 #include <fstream>
 #include <ctime>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
 #include "stringtrie.h"
 #include "binarytree.h"
 #include "linkedlist.h"
+#include "concurrentqueue.h"
+#include "unrolledlinkedlist.h"
 #include "binaryheap.h"
 #include "skiplist.h"
+#include "concurrentskiplist.h"
 #include "stringsequencetrie.h"
+#include "sequencegenerator.h"
+#include "corpusreader.h"
 
 using namespace std;
 void testMenu();
 void linkedListTest();
+void linkedListBenchmark();
+void queueBenchmark();
+void concurrentQueueBenchmark();
 void binaryTreeTest();
 void trieTest();
 void sequenceTrieTest();
 void heapTest();
 void skipListTest();
+void skipListBenchmark();
+void concurrentSkipListBenchmark();
 void storeBookInTrie(StringTrie &book);
 void printLicense();
 
@@ -92,6 +108,9 @@ void linkedListTest() {
     cout << "6 - Remove number at index\n";
     cout << "7 - Find number\n";
     cout << "8 - Print numbers\n";
+    cout << "9 - Benchmark against unrolled list\n";
+    cout << "10 - Producer/consumer queue benchmark\n";
+    cout << "11 - Multithreaded queue benchmark\n";
     cin >> choice;
 
     int index = 0;
@@ -138,6 +157,15 @@ void linkedListTest() {
       case 8:
         my_linked_list.print();
         break;
+      case 9:
+        linkedListBenchmark();
+        break;
+      case 10:
+        queueBenchmark();
+        break;
+      case 11:
+        concurrentQueueBenchmark();
+        break;
       default:
         cout << "Invalid choice!\n";
         break;
@@ -145,6 +173,177 @@ void linkedListTest() {
   }
 }
 
+// prints the time taken by inserts and traversals of count values
+template<class List, class MakeValue>
+void benchmarkList(const string &name, int count, MakeValue make_value) {
+  List list;
+  clock_t start = clock();
+  for (int i = 0; i < count; i++) list.insertEnd(make_value(i));
+  double insert_end = (clock() - start) / (double)CLOCKS_PER_SEC;
+
+  start = clock();
+  for (int i = 0; i < count; i++) list.insertStart(make_value(i));
+  double insert_start = (clock() - start) / (double)CLOCKS_PER_SEC;
+
+  start = clock();
+  for (int i = 0; i < 1000; i++)
+    list.insertAt(make_value(i), (i * 7919) % list.getLength());
+  double insert_at = (clock() - start) / (double)CLOCKS_PER_SEC;
+
+  // a value that isn't in the list makes contains visit every element
+  auto missing = make_value(-1);
+  int found = 0;
+  start = clock();
+  for (int i = 0; i < 20; i++) found += list.contains(missing);
+  double traverse = (clock() - start) / (double)CLOCKS_PER_SEC;
+
+  start = clock();
+  for (int i = 0; i < 1000; i++)
+    found += list.getItemAt((i * 7919) % list.getLength()) == missing;
+  double item_at = (clock() - start) / (double)CLOCKS_PER_SEC;
+
+  start = clock();
+  for (int i = 0; i < 1000; i++)
+    found += list.removeAt((i * 7919) % list.getLength()) == missing;
+  double remove_at = (clock() - start) / (double)CLOCKS_PER_SEC;
+
+  cout << name << ": insertEnd " << insert_end << "s, insertStart "
+       << insert_start << "s, 1000 insertAt " << insert_at
+       << "s, 20 full scans " << traverse << "s, 1000 getItemAt "
+       << item_at << "s, 1000 removeAt " << remove_at << "s"
+       << (found != 0 ? " (found missing value!)" : "")
+       << endl;
+}
+
+// a producer adds bursts of up to 128 values to the end of the list and a
+// consumer takes them off the front, until count values have gone through
+template<class T, class MakeValue>
+void benchmarkQueue(const string &name, int count, MakeValue make_value) {
+  LinkedList<T> queue;
+  T last = T();
+  int produced = 0, consumed = 0;
+  srand(1);
+  clock_t start = clock();
+  while (consumed < count) {
+    for (int burst = rand() % 128 + 1; burst > 0 && produced < count; burst--)
+      queue.insertEnd(make_value(produced++));
+    for (int burst = rand() % 128 + 1; burst > 0 && queue.getLength() > 0; burst--) {
+      last = queue.removeFirst();
+      consumed++;
+    }
+  }
+  double duration = (clock() - start) / (double)CLOCKS_PER_SEC;
+  // the last value taken off has to be the last one put on
+  cout << name << ": " << count << " values in " << duration << "s, "
+       << count / duration / 1e6 << " million per second"
+       << (last == make_value(count - 1) ? "" : " (values out of order!)")
+       << endl;
+}
+
+void queueBenchmark() {
+  int count = 0;
+  cout << "Enter number of values: ";
+  cin >> count;
+  if (count <= 0) return;
+  benchmarkQueue<int>("LinkedList<int>", count, [](int i) { return i; });
+  benchmarkQueue<string>("LinkedList<string>", count, [](int i) {
+    return "a value long enough to be on the heap " + to_string(i);
+  });
+}
+
+// LinkedList behind a mutex, the way a work queue shared between threads
+// is usually done
+template<class T>
+class LockedQueue {
+ public:
+  void insertEnd(T&& value) {
+    lock_guard<mutex> lock(m_mutex);
+    m_list.insertEnd(std::move(value));
+  }
+  bool removeFirst(T* value) {
+    lock_guard<mutex> lock(m_mutex);
+    if (m_list.getLength() == 0) return false;
+    *value = m_list.removeFirst();
+    return true;
+  }
+
+ private:
+  mutex m_mutex;
+  LinkedList<T> m_list;
+};
+
+// threads producers share count values out and as many consumers take
+// them, timed by the wall clock since clock() adds up every thread's time
+template<class Queue, class T, class MakeValue>
+void benchmarkThreadedQueue(const string &name, int count, int threads,
+                            MakeValue make_value) {
+  Queue queue;
+  atomic<int> consumed(0);
+  vector<thread> workers;
+  auto start = chrono::steady_clock::now();
+  for (int p = 0; p < threads; p++) {
+    workers.emplace_back([&queue, &make_value, p, count, threads]() {
+      for (int i = p; i < count; i += threads) queue.insertEnd(make_value(i));
+    });
+  }
+  for (int c = 0; c < threads; c++) {
+    workers.emplace_back([&queue, &consumed, count]() {
+      T value;
+      while (consumed.load(memory_order_relaxed) < count) {
+        if (queue.removeFirst(&value)) consumed.fetch_add(1, memory_order_relaxed);
+        else this_thread::yield();
+      }
+    });
+  }
+  for (thread &worker : workers) worker.join();
+  double duration =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  cout << name << ", " << threads << " producers and " << threads
+       << " consumers: " << count / duration / 1e6 << " million per second"
+       << endl;
+}
+
+void concurrentQueueBenchmark() {
+  int count = 0;
+  cout << "Enter number of values: ";
+  cin >> count;
+  if (count <= 0) return;
+  auto make_number = [](int i) { return i; };
+  auto make_word = [](int i) {
+    return "a value long enough to be on the heap " + to_string(i);
+  };
+  for (int threads = 1; threads <= 8; threads *= 2) {
+    benchmarkThreadedQueue<LockedQueue<int>, int>(
+        "Locked LinkedList<int>", count, threads, make_number);
+    benchmarkThreadedQueue<ConcurrentQueue<int>, int>(
+        "ConcurrentQueue<int>", count, threads, make_number);
+    benchmarkThreadedQueue<LockedQueue<string>, string>(
+        "Locked LinkedList<string>", count, threads, make_word);
+    benchmarkThreadedQueue<ConcurrentQueue<string>, string>(
+        "ConcurrentQueue<string>", count, threads, make_word);
+  }
+}
+
+void linkedListBenchmark() {
+  int count = 0;
+  cout << "Enter number of elements: ";
+  cin >> count;
+  if (count <= 0) return;
+
+  auto make_number = [](int i) { return i; };
+  auto make_word = [](int i) { return "word" + to_string(i); };
+  benchmarkList<LinkedList<int>>("LinkedList<int>", count, make_number);
+  benchmarkList<UnrolledLinkedList<int>>("UnrolledLinkedList<int>", count,
+                                         make_number);
+  benchmarkList<HashedLinkedList<int>>("HashedLinkedList<int>", count,
+                                       make_number);
+  benchmarkList<LinkedList<string>>("LinkedList<string>", count, make_word);
+  benchmarkList<UnrolledLinkedList<string>>("UnrolledLinkedList<string>",
+                                            count, make_word);
+  benchmarkList<HashedLinkedList<string>>("HashedLinkedList<string>", count,
+                                          make_word);
+}
+
 void trieTest() {
   StringTrie my_string_trie;
   int choice = -1;
@@ -320,6 +519,7 @@ void sequenceTrieTest() {
     cout << "2 - Add sequence\n";
     cout << "3 - Print all sequences ordered by occurence\n";
     cout << "4 - Print sequences by occurences in range\n";
+    cout << "5 - Generate text\n";
     cin >> choice;
     string sequence, filename;
     switch (choice) {
@@ -343,6 +543,21 @@ void sequenceTrieTest() {
       case 4:
         sequenceTrieTestPrintHelper(my_sequence_trie);
         break;
+      case 5: {
+        int word_count = 0;
+        double temperature = 1.0;
+        cout << "Enter number of words: ";
+        cin >> word_count;
+        cout << "Enter temperature (1 samples by frequency, 0 picks the most seen): ";
+        cin >> temperature;
+        SequenceGenerator generator(my_sequence_trie, temperature, 0, time(0));
+        clock_t start = clock();
+        string text = generator.generateText(word_count);
+        clock_t duration = clock() - start;
+        cout << text << endl;
+        cout << "Time taken: " << duration / (double)CLOCKS_PER_SEC << " seconds" << endl;
+        break;
+        }
       default:
         cout << "Invalid choice!\n";
         break;
@@ -484,6 +699,9 @@ void skipListTest() {
     cout << "3 - Find number\n";
     cout << "4 - Add random numbers\n";
     cout << "5 - Print numbers\n";
+    cout << "6 - Benchmark\n";
+    cout << "7 - Multithreaded benchmark\n";
+    cout << "8 - Print numbers in a range\n";
     cin >> choice;
 
     int list_input = 0;
@@ -533,6 +751,25 @@ void skipListTest() {
       case 5:
         my_skiplist.print();
         break;
+      case 6:
+        skipListBenchmark();
+        break;
+      case 7:
+        concurrentSkipListBenchmark();
+        break;
+      case 8: {
+        int low = 0;
+        int high = 0;
+        cout << "Enter lowest number: ";
+        cin >> low;
+        cout << "Enter number to stop before: ";
+        cin >> high;
+        int count = my_skiplist.rangeScan(low, high, [](int value) {
+          cout << value << " ";
+        });
+        cout << "\n" << count << " numbers in range\n";
+        break;
+      }
       default:
         cout << "Invalid choice!\n";
         break;
@@ -540,35 +777,127 @@ void skipListTest() {
   }
 }
 
+// prints the time taken by inserts, lookups and removes of count random
+// values, half the lookups missing
+template<class List>
+void benchmarkSkipList(const string &name, int count) {
+  vector<int> values(count);
+  for (int &value : values) value = rand() & ~1;
+  List list;
+  clock_t start = clock();
+  for (int value : values) list.insert(value);
+  double insert = (clock() - start) / (double)CLOCKS_PER_SEC;
+
+  int found = 0;
+  start = clock();
+  for (int value : values) found += list.contains(value) + list.contains(value + 1);
+  double lookup = (clock() - start) / (double)CLOCKS_PER_SEC;
+
+  start = clock();
+  for (int value : values) list.remove(value);
+  double remove = (clock() - start) / (double)CLOCKS_PER_SEC;
+
+  cout << name << ": insert " << insert << "s, " << 2 * count << " lookups "
+       << lookup << "s (" << found << " found), remove " << remove << "s"
+       << endl;
+}
+
+void skipListBenchmark() {
+  int count = 0;
+  cout << "Enter number of values: ";
+  cin >> count;
+  if (count <= 0) return;
+  benchmarkSkipList<SkipList<int>>("SkipList<int>", count);
+  benchmarkSkipList<SkipList<int, less<int>, false>>(
+      "SkipList<int> without back links", count);
+}
+
+// SkipList behind a mutex, for comparison with ConcurrentSkipList. Like
+// ConcurrentSkipList it is a set, so both run the same workload
+class LockedSkipList {
+ public:
+  bool insert(int value) {
+    lock_guard<mutex> lock(m_mutex);
+    if (m_list.contains(value)) return false;
+    m_list.insert(value);
+    return true;
+  }
+  bool remove(int value) {
+    lock_guard<mutex> lock(m_mutex);
+    if (!m_list.contains(value)) return false;
+    m_list.remove(value);
+    return true;
+  }
+  bool contains(int value) {
+    lock_guard<mutex> lock(m_mutex);
+    return m_list.contains(value);
+  }
+
+ private:
+  mutex m_mutex;
+  SkipList<int> m_list;
+};
+
+// threads share count operations on a set holding about half the keys
+// of its range, 80% lookups and 10% each inserts and removes, timed by
+// the wall clock
+template<class Set>
+void benchmarkThreadedSet(const string &name, int count, int threads) {
+  const int range = 1 << 20;
+  Set set;
+  for (int key = 0; key < range; key += 2) set.insert(key);
+  vector<thread> workers;
+  atomic<int> found(0);
+  auto start = chrono::steady_clock::now();
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&set, &found, t, count, threads]() {
+      minstd_rand generator(t + 1);
+      int hits = 0;
+      for (int i = t; i < count; i += threads) {
+        int key = generator() % range;
+        int kind = generator() % 10;
+        if (kind == 0) set.insert(key);
+        else if (kind == 1) set.remove(key);
+        else hits += set.contains(key);
+      }
+      found += hits;
+    });
+  }
+  for (thread &worker : workers) worker.join();
+  double duration =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  cout << name << ", " << threads << " threads: " << count / duration / 1e6
+       << " million operations per second (" << found << " found)" << endl;
+}
+
+void concurrentSkipListBenchmark() {
+  int count = 0;
+  cout << "Enter number of operations: ";
+  cin >> count;
+  if (count <= 0) return;
+  cout << "Hardware threads: " << thread::hardware_concurrency() << endl;
+  for (int threads = 1; threads <= 32; threads *= 2) {
+    benchmarkThreadedSet<LockedSkipList>("Locked SkipList", count, threads);
+    benchmarkThreadedSet<ConcurrentSkipList<int>>("ConcurrentSkipList", count,
+                                                  threads);
+  }
+}
+
 void storeBookInTrie(StringTrie &book) {
-  string filename("GreatExpectations.txt");
-  ifstream infile(filename);
+  string filename("text/GreatExpectations.txt");
+  CorpusReader reader(filename);
 
-  if (!infile.is_open()) cerr << "ERROR: " + filename + "didn't open!\n";
+  if (!reader.isOpen()) cerr << "ERROR: " + filename + " didn't open!\n";
 
   cout << "Now Loading " << filename << "...\n";
 
-  int wordCount = 1;
-  int pageCount = 1;
-  char c;
-  string temp_word;
+  // page separators are all punctuation, so the reader drops them
+  vector<string_view> words;
   clock_t start = clock();
-  while (!infile.eof()) {
-    infile >> temp_word;
-      if (temp_word == "----------------------------------------") {
-      pageCount++;
-      wordCount = 1;
-    } else {
-      c = temp_word[0];
-        if (c < 90 && c > 63)
-        c = c + 32;
-      temp_word = c + temp_word.substr(1, temp_word.size() - 1);
-      book.addWord(temp_word);
-      wordCount++;
-    }
+  while (reader.nextBatch(&words)) {
+    for (string_view word : words) book.addWord(word);
   }
   clock_t duration = clock() - start;
-  infile.close();
   cout << "Time taken to build trie: " << duration / (double)CLOCKS_PER_SEC << " seconds." << endl;
   cout << "Number of unique keys in trie: " << book.getNumberUniqueWords() << endl;
   cout << "Number of total keys in trie: " << book.getNumberTotalWords() << endl;
@@ -0,0 +1,261 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+
+#include "../include/sequencechildren.h"
+
+#include <algorithm>
+#include <new>
+
+#include "../include/stringsequencetrie.h"
+
+SequenceChildren::~SequenceChildren() {
+  if (m_nodes != nullptr) ::operator delete(top());
+}
+
+StringSequenceTrieNode* SequenceChildren::find(const WordId id) const {
+  if (!isHashed()) {
+    const WordId* id_array = ids();
+    for (std::uint32_t i = 0; i < m_size && id_array[i] <= id; i++)
+      if (id_array[i] == id) return m_nodes[i];
+    return nullptr;
+  }
+
+  const WordId* id_array = ids();
+  for (std::uint32_t slot = hashSlot(id); id_array[slot] != kNoWord;
+       slot = (slot + 1) & (m_capacity - 1)) {
+    if (id_array[slot] == id) return m_nodes[slot];
+  }
+  return nullptr;
+}
+
+StringSequenceTrieNode*& SequenceChildren::findOrInsert(const WordId id) {
+  if (!isHashed()) {
+    WordId* id_array = ids();
+    std::uint32_t pos = 0;
+    while (pos < m_size && id_array[pos] < id) pos++;
+    if (pos < m_size && id_array[pos] == id) return m_nodes[pos];
+
+    if (m_size < m_capacity) {
+      // shift larger ids up one slot to keep the array sorted
+      for (std::uint32_t i = m_size; i > pos; i--) {
+        id_array[i] = id_array[i-1];
+        m_nodes[i] = m_nodes[i-1];
+      }
+      id_array[pos] = id;
+      m_nodes[pos] = nullptr;
+      m_size++;
+      return m_nodes[pos];
+    }
+
+    reallocate(m_capacity == 0 ? 1 : m_capacity * 2);
+    return findOrInsert(id);
+  }
+
+  WordId* id_array = ids();
+  std::uint32_t slot = hashSlot(id);
+  for (; id_array[slot] != kNoWord; slot = (slot + 1) & (m_capacity - 1)) {
+    if (id_array[slot] == id) return m_nodes[slot];
+  }
+
+  // keep the load factor at or below 3/4
+  if ((m_size + 1) * 4 > m_capacity * 3) {
+    reallocate(m_capacity * 2);
+    return findOrInsert(id);
+  }
+
+  id_array[slot] = id;
+  m_nodes[slot] = nullptr;
+  m_size++;
+  return m_nodes[slot];
+}
+
+bool SequenceChildren::erase(const WordId id) {
+  WordId* id_array = ids();
+  if (!isHashed()) {
+    std::uint32_t pos = 0;
+    while (pos < m_size && id_array[pos] != id) pos++;
+    if (pos == m_size) return false;
+    for (std::uint32_t i = pos + 1; i < m_size; i++) {
+      id_array[i-1] = id_array[i];
+      m_nodes[i-1] = m_nodes[i];
+    }
+    m_size--;
+    rebuildTop();
+    return true;
+  }
+
+  std::uint32_t mask = m_capacity - 1;
+  std::uint32_t hole = hashSlot(id);
+  while (id_array[hole] != id) {
+    if (id_array[hole] == kNoWord) return false;
+    hole = (hole + 1) & mask;
+  }
+
+  // backward shift deletion, pulls later members of the probe
+  // sequence into the hole so no tombstones are needed
+  for (std::uint32_t next = (hole + 1) & mask; id_array[next] != kNoWord;
+       next = (next + 1) & mask) {
+    std::uint32_t home = hashSlot(id_array[next]);
+    bool can_move = hole <= next ? (home <= hole || home > next)
+                                 : (home <= hole && home > next);
+    if (can_move) {
+      id_array[hole] = id_array[next];
+      m_nodes[hole] = m_nodes[next];
+      hole = next;
+    }
+  }
+  id_array[hole] = kNoWord;
+  m_nodes[hole] = nullptr;
+  m_size--;
+
+  if (m_size <= kMaxSortedChildren / 2) reallocate(kMaxSortedChildren);
+  rebuildTop();
+  return true;
+}
+
+std::uint32_t SequenceChildren::getTopChildren(StringSequenceTrieNode **top,
+                                               std::uint32_t limit) const {
+  StringSequenceTrieNode* scanned[kTopChildren] = {};
+  StringSequenceTrieNode* const* top_children = scanned;
+  if (isHashed()) {
+    top_children = this->top();
+  } else {
+    for (std::uint32_t i = 0; i < m_size; i++) pushTop(scanned, m_nodes[i]);
+  }
+
+  std::uint32_t count = 0;
+  while (count < limit && count < kTopChildren && top_children[count] != nullptr) {
+    top[count] = top_children[count];
+    count++;
+  }
+  return count;
+}
+
+void SequenceChildren::pushTop(StringSequenceTrieNode **top_children,
+                               StringSequenceTrieNode *child) {
+  std::uint32_t position = 0;
+  while (position < kTopChildren && top_children[position] != nullptr &&
+         top_children[position] != child)
+    position++;
+
+  if (position == kTopChildren) {
+    // not cached, replace the least seen cached child if it's been overtaken
+    position = kTopChildren - 1;
+    if (top_children[position]->getTimesSeen() >= child->getTimesSeen())
+      return;
+  }
+  top_children[position] = child;
+
+  while (position > 0 && top_children[position-1]->getTimesSeen() <
+                         child->getTimesSeen()) {
+    top_children[position] = top_children[position-1];
+    top_children[--position] = child;
+  }
+}
+
+void SequenceChildren::rebuildTop() {
+  if (!isHashed()) return;
+  std::fill(top(), top() + kTopChildren, nullptr);
+  for (const auto &child : *this) pushTop(top(), child.second);
+}
+
+void SequenceChildren::shrinkToFit() {
+  if (m_size == 0) {
+    clear();
+    return;
+  }
+
+  std::uint32_t new_capacity = 1;
+  if (m_size <= kMaxSortedChildren) {
+    while (new_capacity < m_size) new_capacity *= 2;
+  } else {
+    while (m_size * 4 > new_capacity * 3) new_capacity *= 2;
+  }
+  // hash tables are always rebuilt, their probe sequences may have holes
+  if (new_capacity != m_capacity || isHashed()) reallocate(new_capacity);
+}
+
+void SequenceChildren::clear() {
+  if (m_nodes != nullptr) ::operator delete(top());
+  m_nodes = nullptr;
+  m_size = 0;
+  m_capacity = 0;
+}
+
+std::size_t SequenceChildren::memoryUsage() const {
+  if (m_nodes == nullptr) return 0;
+  return topSlots(m_capacity) * sizeof(StringSequenceTrieNode*) +
+         m_capacity * (sizeof(StringSequenceTrieNode*) + sizeof(WordId));
+}
+
+void SequenceChildren::reallocate(std::uint32_t new_capacity) {
+  // a hash table must have a power of two number of slots
+  if (new_capacity > kMaxSortedChildren && new_capacity < 2 * kMaxSortedChildren)
+    new_capacity = 2 * kMaxSortedChildren;
+
+  StringSequenceTrieNode** old_nodes = m_nodes;
+  WordId* old_ids = ids();
+  std::uint32_t old_slots = slotCount();
+
+  StringSequenceTrieNode** old_block = m_nodes == nullptr ? nullptr : top();
+
+  StringSequenceTrieNode** block = static_cast<StringSequenceTrieNode**>(
+      ::operator new(topSlots(new_capacity) * sizeof(StringSequenceTrieNode*) +
+          new_capacity * (sizeof(StringSequenceTrieNode*) + sizeof(WordId))));
+  m_nodes = block + topSlots(new_capacity);
+  m_capacity = new_capacity;
+  WordId* id_array = ids();
+
+  if (isHashed()) {
+    std::fill(id_array, id_array + m_capacity, kNoWord);
+    std::fill(m_nodes, m_nodes + m_capacity, nullptr);
+    for (std::uint32_t i = 0; i < old_slots; i++) {
+      if (old_ids[i] == kNoWord) continue;
+      std::uint32_t slot = hashSlot(old_ids[i]);
+      while (id_array[slot] != kNoWord) slot = (slot + 1) & (m_capacity - 1);
+      id_array[slot] = old_ids[i];
+      m_nodes[slot] = old_nodes[i];
+    }
+  } else {
+    // insertion sort keeps the order when shrinking out of a hash table,
+    // and is a plain copy when the old array was already sorted
+    std::uint32_t count = 0;
+    for (std::uint32_t i = 0; i < old_slots; i++) {
+      if (old_ids[i] == kNoWord) continue;
+      std::uint32_t pos = count++;
+      while (pos > 0 && id_array[pos-1] > old_ids[i]) {
+        id_array[pos] = id_array[pos-1];
+        m_nodes[pos] = m_nodes[pos-1];
+        pos--;
+      }
+      id_array[pos] = old_ids[i];
+      m_nodes[pos] = old_nodes[i];
+    }
+  }
+
+  ::operator delete(old_block);
+  rebuildTop();
+}
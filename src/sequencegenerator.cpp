@@ -0,0 +1,214 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+#include "sequencegenerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+struct SequenceGenerator::AliasTable {
+  struct Entry {
+    // the entry is picked if the low 32 bits of the random number are
+    // below threshold, otherwise the entry at alias is
+    std::uint32_t threshold;
+    std::uint32_t alias;
+    WordId word;
+    // context after word, and its table once it has been needed
+    const StringSequenceTrieNode* next_node;
+    AliasTable* next_table;
+  };
+
+  explicit AliasTable(const StringSequenceTrieNode* context) : node(context) {}
+
+  const StringSequenceTrieNode* node;
+  std::vector<Entry> entries;
+};
+
+SequenceGenerator::SequenceGenerator(const StringSequenceTrie &trie,
+                                     double temperature, int top_k,
+                                     std::uint64_t seed)
+    : m_trie(trie), m_temperature(temperature), m_top_k(top_k),
+      m_random(seed), m_table(nullptr) {
+  m_table = getTable(m_trie.m_seq_head);
+}
+
+SequenceGenerator::~SequenceGenerator() {}
+
+void SequenceGenerator::setTemperature(double temperature) {
+  m_temperature = temperature;
+  clearTables();
+}
+
+void SequenceGenerator::setTopK(int top_k) {
+  m_top_k = top_k;
+  clearTables();
+}
+
+void SequenceGenerator::clearTables() {
+  const StringSequenceTrieNode* node = m_table->node;
+  m_tables.clear();
+  m_table = getTable(node);
+}
+
+void SequenceGenerator::setContext(const WordId* words, int length) {
+  const int context_size = std::max(m_trie.getWindowSize() - 1, 0);
+  if (length > context_size) {
+    words += length - context_size;
+    length = context_size;
+  }
+  m_table = getTable(findContext(words, length));
+}
+
+void SequenceGenerator::setContext(std::string_view words) {
+  std::vector<WordId> ids = m_trie.getWordIds(words);
+  setContext(ids.data(), ids.size());
+}
+
+const StringSequenceTrieNode* SequenceGenerator::findContext(
+    const WordId* words, int length) const {
+  for (int start = 0; start < length; start++) {
+    const StringSequenceTrieNode* node =
+        m_trie.findSequence(m_trie.m_seq_head, words + start, length - start);
+    if (node != nullptr && !node->m_next_word.empty()) return node;
+  }
+  return m_trie.m_seq_head;
+}
+
+SequenceGenerator::AliasTable* SequenceGenerator::getTable(
+    const StringSequenceTrieNode* node) {
+  std::unique_ptr<AliasTable> &table = m_tables[node];
+  if (table != nullptr) return table.get();
+  table.reset(new AliasTable(node));
+
+  // most seen first, so top k is a prefix
+  std::vector<const StringSequenceTrieNode*> children;
+  children.reserve(node->m_next_word.size());
+  for (const auto &next_word : node->m_next_word)
+    children.push_back(next_word.second);
+  auto more_seen = [](const StringSequenceTrieNode* a,
+                      const StringSequenceTrieNode* b) {
+    return a->m_times_seen > b->m_times_seen ||
+           (a->m_times_seen == b->m_times_seen && a->m_word < b->m_word);
+  };
+  std::size_t count = children.size();
+  if (m_temperature <= 0) count = std::min<std::size_t>(count, 1);
+  if (m_top_k > 0) count = std::min<std::size_t>(count, m_top_k);
+  std::partial_sort(children.begin(), children.begin() + count,
+                    children.end(), more_seen);
+  children.resize(count);
+  if (count == 0) return table.get();
+
+  // weights relative to the most seen word, which keeps low temperatures
+  // from overflowing
+  std::vector<double> weights(count);
+  double total = 0;
+  const double most_seen = std::log(children[0]->m_times_seen);
+  for (std::size_t i = 0; i < count; i++) {
+    double log_count = std::log(children[i]->m_times_seen);
+    weights[i] = m_temperature == 1.0 ? children[i]->m_times_seen
+        : std::exp((log_count - most_seen) / m_temperature);
+    total += weights[i];
+  }
+
+  // the context after each word is its node if that was continued,
+  // otherwise the longest continued suffix
+  const int context_size = std::max(m_trie.getWindowSize() - 1, 0);
+  std::vector<WordId> context;
+  for (const StringSequenceTrieNode* current = node;
+       current != m_trie.m_seq_head; current = current->m_parent)
+    context.push_back(current->m_word);
+  std::reverse(context.begin(), context.end());
+  context.push_back(kNoWord);
+
+  // Vose's alias method, every column is filled to the average weight,
+  // topping up light columns from a heavy one
+  std::vector<AliasTable::Entry> &entries = table->entries;
+  entries.resize(count);
+  std::vector<std::uint32_t> light, heavy;
+  for (std::size_t i = 0; i < count; i++) {
+    weights[i] *= count / total;
+    (weights[i] < 1.0 ? light : heavy).push_back(i);
+
+    context.back() = children[i]->m_word;
+    const int length = context.size();
+    const int start = std::max(length - context_size, 0);
+    entries[i].word = children[i]->m_word;
+    entries[i].next_node = findContext(context.data() + start, length - start);
+    entries[i].next_table = nullptr;
+    entries[i].threshold = UINT32_MAX;
+    entries[i].alias = i;
+  }
+  while (!light.empty() && !heavy.empty()) {
+    std::uint32_t small = light.back(), large = heavy.back();
+    light.pop_back();
+    entries[small].threshold =
+        static_cast<std::uint32_t>(weights[small] * 4294967296.0);
+    entries[small].alias = large;
+    weights[large] -= 1.0 - weights[small];
+    if (weights[large] < 1.0) {
+      heavy.pop_back();
+      light.push_back(large);
+    }
+  }
+  // whatever is left is full up to rounding
+  return table.get();
+}
+
+WordId SequenceGenerator::nextWord() {
+  const std::vector<AliasTable::Entry> &entries = m_table->entries;
+  if (entries.empty()) return kNoWord;
+
+  // high bits pick a column, low bits choose between it and its alias
+  const std::uint64_t random = m_random();
+  const std::size_t column = ((random >> 32) * entries.size()) >> 32;
+  const std::size_t index =
+      static_cast<std::uint32_t>(random) < entries[column].threshold
+          ? column : entries[column].alias;
+
+  AliasTable::Entry &entry = m_table->entries[index];
+  if (entry.next_table == nullptr) entry.next_table = getTable(entry.next_node);
+  m_table = entry.next_table;
+  return entry.word;
+}
+
+void SequenceGenerator::generate(std::size_t count, std::vector<WordId>* words) {
+  words->reserve(words->size() + count);
+  for (std::size_t i = 0; i < count; i++) {
+    WordId word = nextWord();
+    if (word == kNoWord) break;
+    words->push_back(word);
+  }
+}
+
+std::string SequenceGenerator::generateText(std::size_t count) {
+  std::string text;
+  for (std::size_t i = 0; i < count; i++) {
+    WordId word = nextWord();
+    if (word == kNoWord) break;
+    if (i != 0) text += ' ';
+    text += m_trie.getWord(word);
+  }
+  return text;
+}
@@ -0,0 +1,150 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+
+#include "../include/sequencelanguagemodel.h"
+
+#include <algorithm>
+#include <cmath>
+
+SequenceLanguageModel::SequenceLanguageModel(const StringSequenceTrie &trie,
+                                             Smoothing smoothing,
+                                             double discount,
+                                             double backoff_weight)
+    : m_trie(trie), m_smoothing(smoothing), m_discount(discount),
+      m_backoff_weight(backoff_weight) {}
+
+double SequenceLanguageModel::getProbability(const WordId *context,
+                                             int context_length,
+                                             WordId word) const {
+  // an n-gram model only looks at the last n - 1 words
+  int max_context = std::max(0, m_trie.getWindowSize() - 1);
+  if (context_length > max_context) {
+    context += context_length - max_context;
+    context_length = max_context;
+  }
+
+  if (m_smoothing == Smoothing::kKneserNey)
+    return getKneserNeyProbability(context, context_length, word);
+  else
+    return getStupidBackoffScore(context, context_length, word);
+}
+
+double SequenceLanguageModel::getKneserNeyProbability(const WordId *context,
+    int context_length, WordId word) const {
+  // start from the uniform distribution, with one extra slot for words
+  // that have never been seen
+  double probability = 1.0 / (m_trie.getNumberUniqueWords() + 1);
+
+  // the backward trie holds word followed by the context in reverse, so one
+  // walk down it gives the N1+(. h w) continuation count for every order
+  const StringSequenceTrieNode* backward = word == kNoWord ? nullptr :
+      m_trie.m_seq_backward_head->m_next_word.find(word);
+
+  for (int order = 0; order <= context_length; order++) {
+    const WordId* history = context + context_length - order;
+    const StringSequenceTrieNode* history_node =
+        m_trie.findSequence(m_trie.m_seq_head, history, order);
+    if (history_node == nullptr) break;
+
+    // count and denominator, and the number of words w with a nonzero
+    // count, which the discount was taken from
+    double count = 0, denominator = 0, discounted = 0;
+    if (order == context_length) {
+      // highest order uses the raw counts
+      const StringSequenceTrieNode* next = word == kNoWord ? nullptr :
+          history_node->m_next_word.find(word);
+      count = next == nullptr ? 0 : next->m_times_seen;
+      denominator = history_node->m_successor_count;
+      discounted = history_node->m_next_word.size();
+    } else {
+      // lower orders count the distinct words seen before h w
+      count = backward == nullptr ? 0 : backward->m_next_word.size();
+      denominator = history_node->m_continuation_count;
+      discounted = history_node->m_continued_count;
+    }
+    if (denominator == 0) break;
+
+    double leftover = m_discount * discounted / denominator;
+    probability = std::max(count - m_discount, 0.0) / denominator +
+                  leftover * probability;
+
+    if (backward != nullptr && order < context_length)
+      backward = backward->m_next_word.find(context[context_length - order - 1]);
+  }
+  return probability;
+}
+
+double SequenceLanguageModel::getStupidBackoffScore(const WordId *context,
+    int context_length, WordId word) const {
+  double weight = 1.0;
+  for (int order = context_length; order >= 0; order--) {
+    const StringSequenceTrieNode* history_node = m_trie.findSequence(
+        m_trie.m_seq_head, context + context_length - order, order);
+    if (history_node != nullptr && history_node->m_successor_count > 0) {
+      const StringSequenceTrieNode* next = word == kNoWord ? nullptr :
+          history_node->m_next_word.find(word);
+      if (next != nullptr)
+        return weight * next->m_times_seen / history_node->m_successor_count;
+    }
+    weight *= m_backoff_weight;
+  }
+
+  // never seen, score as if it had been seen once
+  int total = std::max(m_trie.m_seq_head->m_successor_count, 1);
+  return weight / total;
+}
+
+double SequenceLanguageModel::getLogProbability(const WordId *words,
+                                                int length) const {
+  double log_probability = 0;
+  for (int i = 0; i < length; i++)
+    log_probability += std::log(getProbability(words, i, words[i]));
+  return log_probability;
+}
+
+double SequenceLanguageModel::getLogProbability(const std::string &sentence) const {
+  std::vector<WordId> words = m_trie.getWordIds(sentence);
+  return getLogProbability(words.data(), words.size());
+}
+
+void SequenceLanguageModel::scoreSentences(
+    const std::vector<std::vector<WordId>> &sentences,
+    std::vector<double> *scores) const {
+  scores->resize(sentences.size());
+  for (std::size_t i = 0; i < sentences.size(); i++)
+    (*scores)[i] = getLogProbability(sentences[i].data(), sentences[i].size());
+}
+
+void SequenceLanguageModel::rankSentences(
+    const std::vector<std::vector<WordId>> &sentences,
+    std::vector<double> *scores, std::vector<int> *ranking) const {
+  scoreSentences(sentences, scores);
+  ranking->resize(sentences.size());
+  for (std::size_t i = 0; i < sentences.size(); i++) (*ranking)[i] = i;
+  std::sort(ranking->begin(), ranking->end(), [scores](int left, int right) {
+    return (*scores)[left] > (*scores)[right];
+  });
+}
@@ -0,0 +1,340 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+
+#include "sequencesuffixarray.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iostream>
+
+#include "corpusreader.h"
+
+void SequenceSuffixArray::addSequence(const std::vector<std::string> &sequence) {
+  for (const std::string &word : sequence) {
+    WordId id = addWord(word);
+    if (id != kNoWord) m_text.push_back(id);
+  }
+  m_text.push_back(kNoWord);
+  m_documents++;
+  buildSuffixArray();
+}
+
+void SequenceSuffixArray::addSequence(const std::string_view *words,
+                                      std::size_t count) {
+  for (std::size_t i = 0; i < count; i++) {
+    WordId id = addWord(words[i]);
+    if (id != kNoWord) m_text.push_back(id);
+  }
+  m_text.push_back(kNoWord);
+  m_documents++;
+  buildSuffixArray();
+}
+
+void SequenceSuffixArray::loadTextFile(std::string file_name) {
+  loadTextFiles({file_name});
+}
+
+void SequenceSuffixArray::loadTextFiles(const std::vector<std::string> &file_names) {
+  auto start = std::chrono::steady_clock::now();
+  for (const std::string &name : file_names) {
+    std::string file_name = name == "" ? "books/Mark_Twain_LifeOnTheMississippi.txt"
+                                       : "books/" + name;
+    std::cout << "Now Loading " << file_name << "...\n";
+    if (!readTextFile(file_name))
+      std::cerr << "ERROR: " << file_name << " didn't open!\n";
+  }
+  buildSuffixArray();
+
+  std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+  std::cout << "Time taken: " << duration.count() << " seconds" << std::endl;
+  std::cout << "Words: " << getNumberWords() << ", "
+            << memoryUsage() / 1024 << " KB" << std::endl;
+}
+
+bool SequenceSuffixArray::readTextFile(const std::string &file_name) {
+  CorpusReader reader(file_name);
+  if (!reader.isOpen()) return false;
+
+  std::vector<std::string_view> words;
+  while (reader.nextBatch(&words)) {
+    for (std::string_view word : words) {
+      WordId id = addWord(word);
+      if (id != kNoWord) m_text.push_back(id);
+    }
+  }
+  m_text.push_back(kNoWord);
+  m_documents++;
+  return true;
+}
+
+WordId SequenceSuffixArray::addWord(std::string_view word) {
+  if (word == "" || word == " ") return kNoWord;
+
+  std::string key(word);
+  for (char &c : key) c = std::tolower(static_cast<unsigned char>(c));
+  auto inserted = m_word_ids.emplace(key, m_words.size());
+  if (inserted.second) m_words.push_back(std::move(key));
+  return inserted.first->second;
+}
+
+WordId SequenceSuffixArray::getWordId(std::string_view word) const {
+  std::string key(word);
+  for (char &c : key) c = std::tolower(static_cast<unsigned char>(c));
+  auto found = m_word_ids.find(key);
+  return found == m_word_ids.end() ? kNoWord : found->second;
+}
+
+std::vector<WordId> SequenceSuffixArray::getWordIds(std::string_view sequence) const {
+  std::vector<WordId> ids;
+  std::size_t start = 0;
+  while ((start = sequence.find_first_not_of(' ', start)) != std::string_view::npos) {
+    std::size_t end = std::min(sequence.find(' ', start), sequence.size());
+    ids.push_back(getWordId(sequence.substr(start, end - start)));
+    start = end;
+  }
+  return ids;
+}
+
+void SequenceSuffixArray::buildSuffixArray() {
+  const std::uint32_t size = m_text.size();
+  m_suffixes.resize(size);
+  if (size == 0) return;
+
+  // ranks start as the word ids, with the separators after every word
+  std::vector<std::uint32_t> rank(size), next_rank(size);
+  for (std::uint32_t i = 0; i < size; i++) {
+    m_suffixes[i] = i;
+    rank[i] = m_text[i] == kNoWord ? m_words.size() : m_text[i];
+  }
+
+  // after each round suffixes are sorted by their first 2 * length words.
+  // a suffix with fewer words left sorts first, though that only happens
+  // past a separator
+  for (std::uint32_t length = 1; ; length *= 2) {
+    auto second = [&rank, length, size](std::uint32_t suffix) {
+      return suffix + length < size ? rank[suffix + length] + 1ull : 0ull;
+    };
+    auto less = [&rank, &second](std::uint32_t left, std::uint32_t right) {
+      if (rank[left] != rank[right]) return rank[left] < rank[right];
+      return second(left) < second(right);
+    };
+    std::sort(m_suffixes.begin(), m_suffixes.end(), less);
+
+    next_rank[m_suffixes[0]] = 0;
+    for (std::uint32_t i = 1; i < size; i++)
+      next_rank[m_suffixes[i]] = next_rank[m_suffixes[i - 1]] +
+          less(m_suffixes[i - 1], m_suffixes[i]);
+    rank.swap(next_rank);
+    // every suffix has a distinct rank once they're fully sorted
+    if (rank[m_suffixes[size - 1]] == size - 1 || length >= size) break;
+  }
+}
+
+SequenceSuffixArray::Range SequenceSuffixArray::narrow(Range range, int depth,
+                                                       WordId word) const {
+  // suffixes in range are sorted by their word at depth
+  std::uint32_t low = range.begin, high = range.end;
+  while (low < high) {
+    std::uint32_t middle = low + (high - low) / 2;
+    if (wordAt(middle, depth) < word) low = middle + 1;
+    else high = middle;
+  }
+  Range narrowed = {low, low};
+  high = range.end;
+  while (low < high) {
+    std::uint32_t middle = low + (high - low) / 2;
+    if (wordAt(middle, depth) <= word) low = middle + 1;
+    else high = middle;
+  }
+  narrowed.end = low;
+  return narrowed;
+}
+
+SequenceSuffixArray::Range SequenceSuffixArray::find(const WordId *words,
+                                                     int length) const {
+  Range range = {0, static_cast<std::uint32_t>(m_suffixes.size())};
+  for (int i = 0; i < length && range.size() != 0; i++)
+    range = words[i] == kNoWord ? Range{0, 0} : narrow(range, i, words[i]);
+  return range;
+}
+
+template <typename Visitor>
+void SequenceSuffixArray::forEachNextWord(Range range, int depth,
+                                          Visitor visit) const {
+  std::uint32_t begin = range.begin;
+  while (begin < range.end) {
+    WordId word = wordAt(begin, depth);
+    // separators sort after every word
+    if (word == kNoWord) break;
+    Range next = narrow(Range{begin, range.end}, depth, word);
+    visit(word, next);
+    begin = next.end;
+  }
+}
+
+std::size_t SequenceSuffixArray::getCount(const WordId *words, int length) const {
+  return find(words, length).size();
+}
+
+std::size_t SequenceSuffixArray::getCount(std::string_view sequence) const {
+  std::vector<WordId> words = getWordIds(sequence);
+  return getCount(words.data(), words.size());
+}
+
+int SequenceSuffixArray::predictNextWords(const WordId *context,
+    int context_length, std::vector<WordId> *next_words, int limit) const {
+  next_words->clear();
+  std::vector<std::pair<std::uint32_t, WordId>> candidates;
+  for (int start = 0; start <= context_length; start++) {
+    int length = context_length - start;
+    Range range = find(context + start, length);
+    candidates.clear();
+    forEachNextWord(range, length, [&candidates](WordId word, Range next) {
+      candidates.emplace_back(next.size(), word);
+    });
+    if (candidates.empty()) continue;
+
+    // most seen first, ties in word id order like the trie's sorted children
+    std::size_t size = std::min<std::size_t>(std::max(limit, 0), candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + size, candidates.end(),
+                      [](const std::pair<std::uint32_t, WordId> &left,
+                         const std::pair<std::uint32_t, WordId> &right) {
+      return left.first != right.first ? left.first > right.first
+                                       : left.second < right.second;
+    });
+    for (std::size_t i = 0; i < size; i++)
+      next_words->push_back(candidates[i].second);
+    return length;
+  }
+  return 0;
+}
+
+std::string SequenceSuffixArray::getNextWord(std::string_view sequence) const {
+  std::vector<WordId> context = getWordIds(sequence);
+  std::vector<WordId> next_words;
+  predictNextWords(context.data(), context.size(), &next_words, 1);
+  return next_words.empty() ? "" : getWord(next_words[0]);
+}
+
+struct SequenceSuffixArray::OrderedWordsSearch {
+  // a sequence found, as its first occurence in the text
+  struct Sequence {
+    std::uint32_t count;
+    std::uint32_t position;
+    int length;
+  };
+
+  // orders a heap with the least seen sequence at the front
+  static bool moreSeen(const Sequence &left, const Sequence &right) {
+    return left.count > right.count;
+  }
+
+  bool isFull() const { return limit != 0 && sequences.size() >= limit; }
+
+  void offer(const Sequence &sequence) {
+    if (isFull()) {
+      if (sequence.count <= sequences.front().count) return;
+      std::pop_heap(sequences.begin(), sequences.end(), moreSeen);
+      sequences.back() = sequence;
+    } else {
+      sequences.push_back(sequence);
+    }
+    std::push_heap(sequences.begin(), sequences.end(), moreSeen);
+  }
+
+  const StringSequenceTrie::SequenceCriteria* criteria;
+  std::size_t limit;
+  // heap of the best sequences found so far
+  std::vector<Sequence> sequences;
+  // scratch space for sorting next words, one per sequence length
+  std::vector<std::vector<std::pair<std::uint32_t, Range>>> children;
+};
+
+std::vector<std::pair<std::string, int>> SequenceSuffixArray::getOrderedWords(
+    const StringSequenceTrie::SequenceCriteria &criteria, int limit) const {
+  std::vector<WordId> start = getWordIds(criteria.m_starting_sequence);
+  Range range = find(start.data(), start.size());
+
+  std::vector<std::pair<std::string, int>> ordered;
+  if (range.size() == 0 || criteria.m_length_max_count < 1) return ordered;
+
+  OrderedWordsSearch search;
+  search.criteria = &criteria;
+  search.limit = std::max(limit, 0);
+  search.children.resize(criteria.m_length_max_count + 1);
+  getOrderedWordsHelper(range, start.size(), &search, 1);
+
+  std::sort_heap(search.sequences.begin(), search.sequences.end(),
+                 OrderedWordsSearch::moreSeen);
+  for (const OrderedWordsSearch::Sequence &sequence : search.sequences) {
+    // words are separated and ended by spaces like buildSequenceFromFinalNode
+    std::string words;
+    for (int i = 0; i < sequence.length; i++)
+      words += m_words[m_text[sequence.position + i]] + " ";
+    ordered.emplace_back(std::move(words), sequence.count);
+  }
+  return ordered;
+}
+
+void SequenceSuffixArray::getOrderedWordsHelper(Range range, int depth,
+    OrderedWordsSearch *search, int current_sequence_length) const {
+  const StringSequenceTrie::SequenceCriteria &criteria = *search->criteria;
+  if (current_sequence_length > criteria.m_length_max_count) return;
+
+  std::vector<std::pair<std::uint32_t, Range>> &words =
+      search->children[current_sequence_length];
+  words.clear();
+  forEachNextWord(range, depth, [&words, &criteria](WordId, Range next) {
+    if ((int)next.size() >= criteria.m_frequency_min)
+      words.emplace_back(next.size(), next);
+  });
+  if (words.empty()) return;
+
+  int size = std::min((int)words.size(), criteria.m_branching_factor);
+  std::partial_sort(words.begin(), words.begin() + size, words.end(),
+                    [](const std::pair<std::uint32_t, Range> &left,
+                       const std::pair<std::uint32_t, Range> &right) {
+    return left.first > right.first;
+  });
+
+  for (int i = 0; i < size; i++) {
+    const std::uint32_t count = words[i].first;
+    const Range next = words[i].second;
+    if (search->isFull() && count <= search->sequences.front().count) break;
+
+    if (current_sequence_length >= criteria.m_length_min_count &&
+        (int)count <= criteria.m_frequency_max)
+      search->offer({count, m_suffixes[next.begin], depth + 1});
+
+    getOrderedWordsHelper(next, depth + 1, search, current_sequence_length + 1);
+  }
+}
+
+std::size_t SequenceSuffixArray::memoryUsage() const {
+  return m_text.capacity() * sizeof(WordId) +
+         m_suffixes.capacity() * sizeof(std::uint32_t);
+}
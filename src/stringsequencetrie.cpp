@@ -24,68 +24,556 @@
 **                                                                                 **
 ************************************************************************************/
 
+#include <cctype>
+#include <chrono>
 #include <ctime>
 #include <fstream>
 #include <string>
+#include <thread>
 #include <utility>
 #include <map>
+#include <memory>
 #include <algorithm>
 #include <iomanip>
 
+#include "corpusreader.h"
+#include "mappedfile.h"
 #include "stringsequencetrie.h"
 #include "stringtrie.h"
 
 StringSequenceTrieNode::StringSequenceTrieNode(
-    StringTrieNode *string_trie_node, StringSequenceTrieNode *parent)
-    : m_trie_word_node(string_trie_node), m_parent(parent), m_next_word(),
-      m_times_seen(1) {}
+    WordId word, StringSequenceTrieNode *parent)
+    : m_word(word), m_times_seen(0), m_successor_count(0),
+      m_continuation_count(0), m_continued_count(0), m_parent(parent),
+      m_next_word() {}
+
+StringSequenceTrieNode::~StringSequenceTrieNode() {
+  for (const auto &next_word : m_next_word)
+    delete next_word.second;
+}
+
+std::size_t StringSequenceTrieNode::memoryUsage() const {
+  std::size_t bytes = sizeof(*this) + m_next_word.memoryUsage();
+  for (const auto &next_word : m_next_word)
+    bytes += next_word.second->memoryUsage();
+  return bytes;
+}
+
+
+std::size_t StringSequenceTrieNode::prune(int min_count) {
+  std::size_t removed = 0;
+  m_next_word.eraseIf([&removed, min_count](StringSequenceTrieNode* child) {
+    if (child->m_times_seen >= min_count) {
+      removed += child->prune(min_count);
+      return false;
+    }
+    // a child is seen at most as often as its parent, so the whole
+    // subtrie goes
+    removed += deleteSubtrie(child);
+    return true;
+  });
+  return removed;
+}
+
+std::size_t StringSequenceTrieNode::deleteSubtrie(StringSequenceTrieNode *node) {
+  std::size_t deleted = 1;
+  for (const auto &next_word : node->m_next_word)
+    deleted += deleteSubtrie(next_word.second);
+  node->m_next_word.clear();
+  delete node;
+  return deleted;
+}
 
 
 StringSequenceTrie::StringSequenceTrie() : m_trie(new StringTrie()),
-    m_seq_head(new StringSequenceTrieNode(m_trie->m_trie_head, nullptr)),
-    m_seq_backward_head(new StringSequenceTrieNode(m_trie->m_trie_head, nullptr)),
-    m_total_words(0) {}
+    m_seq_head(new StringSequenceTrieNode(kNoWord, nullptr)),
+    m_seq_backward_head(new StringSequenceTrieNode(kNoWord, nullptr)),
+    m_total_words(0), m_window_size(5), m_memory_budget(0) {}
+
+StringSequenceTrie::~StringSequenceTrie() {
+  delete m_seq_head;
+  delete m_seq_backward_head;
+  delete m_trie;
+}
+
+// splits the first space separated word off text into word, returns false
+// once text has no words left
+static bool nextWord(std::string_view *text, std::string_view *word) {
+  std::size_t start = text->find_first_not_of(' ');
+  if (start == std::string_view::npos) {
+    text->remove_prefix(text->size());
+    return false;
+  }
+  std::size_t end = std::min(text->find(' ', start), text->size());
+  *word = text->substr(start, end - start);
+  text->remove_prefix(end);
+  return true;
+}
+
+// same as nextWord, splitting off the last word instead
+static bool previousWord(std::string_view *text, std::string_view *word) {
+  std::size_t end = text->find_last_not_of(' ');
+  if (end == std::string_view::npos) {
+    text->remove_suffix(text->size());
+    return false;
+  }
+  std::size_t start = text->find_last_of(' ', end);
+  start = start == std::string_view::npos ? 0 : start + 1;
+  *word = text->substr(start, end + 1 - start);
+  text->remove_suffix(text->size() - start);
+  return true;
+}
+
+WordId StringSequenceTrie::addWord(std::string_view word, int occurences) {
+  StringTrieNode* word_node = m_trie->insertWord(word, occurences);
+  if (word_node == nullptr) return kNoWord;
+
+  if (word_node->word_id == kNoWord) {
+    word_node->word_id = m_vocabulary.size();
+    m_vocabulary.push_back(word_node);
+  }
+  return word_node->word_id;
+}
+
+WordId StringSequenceTrie::getWordId(std::string_view word) const {
+  StringTrieNode* word_node = m_trie->getNode(word);
+  return word_node == nullptr ? kNoWord : word_node->word_id;
+}
+
+std::string StringSequenceTrie::getWord(WordId word) const {
+  return m_trie->buildStringFromFinalNode(m_vocabulary[word]);
+}
 
-void StringSequenceTrie::addSequence(const std::string &sequence) {
-  addSequenceHelper(sequence, m_seq_head, 0);
-  addSequenceBackwardHelper(sequence, m_seq_backward_head, sequence.size());
+std::size_t StringSequenceTrie::getNumberNodes() const {
+  std::size_t count = 0;
+  std::vector<const StringSequenceTrieNode*> stack = {m_seq_head,
+                                                      m_seq_backward_head};
+  while (!stack.empty()) {
+    const StringSequenceTrieNode* current = stack.back();
+    stack.pop_back();
+    count++;
+    for (const auto &next_word : current->m_next_word)
+      stack.push_back(next_word.second);
+  }
+  return count;
+}
+
+void StringSequenceTrie::updateContinuationCounts() {
+  // a child w of h counts towards h's continued count if the backward
+  // node for h w, reached from w through h's words newest first, has a
+  // word before it. That is the node the model reads N1+(. h w) from
+  std::vector<StringSequenceTrieNode*> nodes = {m_seq_head};
+  while (!nodes.empty()) {
+    StringSequenceTrieNode* current = nodes.back();
+    nodes.pop_back();
+    current->m_successor_count = 0;
+    current->m_continuation_count = 0;
+    current->m_continued_count = 0;
+    for (const auto &next_word : current->m_next_word) {
+      current->m_successor_count += next_word.second->m_times_seen;
+      nodes.push_back(next_word.second);
+
+      const StringSequenceTrieNode* backward =
+          m_seq_backward_head->m_next_word.find(next_word.first);
+      for (const StringSequenceTrieNode* word = current;
+           backward != nullptr && word != m_seq_head; word = word->m_parent)
+        backward = backward->m_next_word.find(word->m_word);
+      if (backward != nullptr && backward->m_next_word.size() > 0)
+        current->m_continued_count++;
+    }
+  }
+
+  // each forward node is visited along with the node for its sequence
+  // minus the first word. a node v h with children w adds its number of
+  // children to the N1+(. h .) count of the node for h
+  std::vector<std::pair<StringSequenceTrieNode*, StringSequenceTrieNode*>> stack;
+
+  for (const auto &next_word : m_seq_head->m_next_word)
+    stack.push_back(std::make_pair(next_word.second, m_seq_head));
+
+  while (!stack.empty()) {
+    StringSequenceTrieNode* current = stack.back().first;
+    StringSequenceTrieNode* suffix = stack.back().second;
+    stack.pop_back();
+    suffix->m_continuation_count += current->m_next_word.size();
+
+    for (const auto &next_word : current->m_next_word) {
+      // sequences added whole by addSequence may lack their suffixes
+      StringSequenceTrieNode* next_suffix = suffix->m_next_word.find(next_word.first);
+      if (next_suffix != nullptr)
+        stack.push_back(std::make_pair(next_word.second, next_suffix));
+    }
+  }
+}
+
+std::size_t StringSequenceTrie::memoryUsage() const {
+  return m_seq_head->memoryUsage() + m_seq_backward_head->memoryUsage() +
+         m_vocabulary.capacity() * sizeof(StringTrieNode*);
+}
+
+std::size_t StringSequenceTrie::prune(int min_count) {
+  return m_seq_head->prune(min_count) + m_seq_backward_head->prune(min_count);
+}
+
+int StringSequenceTrie::compactToBudget(std::size_t bytes) {
+  if (memoryUsage() <= bytes) return 0;
+
+  // bytes held by the nodes seen exactly count times, higher counts share
+  // the last bucket. pruning with min_count keeps exactly the nodes seen
+  // at least min_count times, as every ancestor is seen at least as often
+  const int kMaxCount = 1 << 16;
+  std::vector<std::size_t> bytes_by_count(kMaxCount + 1, 0);
+  std::size_t kept_bytes = sizeof(StringSequenceTrieNode) * 2 +
+      m_seq_head->m_next_word.memoryUsage() +
+      m_seq_backward_head->m_next_word.memoryUsage() +
+      m_vocabulary.capacity() * sizeof(StringTrieNode*);
+  std::vector<const StringSequenceTrieNode*> stack = {m_seq_head,
+                                                      m_seq_backward_head};
+  while (!stack.empty()) {
+    const StringSequenceTrieNode* current = stack.back();
+    stack.pop_back();
+    for (const auto &next_word : current->m_next_word) {
+      const StringSequenceTrieNode* child = next_word.second;
+      bytes_by_count[std::min(std::max(child->m_times_seen, 0), kMaxCount)] +=
+          sizeof(StringSequenceTrieNode) + child->m_next_word.memoryUsage();
+      stack.push_back(child);
+    }
+  }
+
+  // raise min_count until the nodes left fit. the heads' arrays shrink as
+  // well, so this overestimates what is kept
+  int min_count = kMaxCount;
+  while (min_count > 0 && kept_bytes + bytes_by_count[min_count] <= bytes)
+    kept_bytes += bytes_by_count[min_count--];
+  min_count++;
+
+  prune(min_count);
+  return min_count;
+}
+
+std::size_t StringSequenceTrie::enforceMemoryBudget(SequenceWindow *window) {
+  window->clearNewNodes();
+  std::size_t usage = memoryUsage();
+  if (usage > m_memory_budget) {
+    // the window may be on pruned nodes, a few sequences spanning the
+    // compaction are lost
+    window->reset();
+    compactToBudget(m_memory_budget / 2);
+    usage = memoryUsage();
+  }
+
+  // a new node costs itself and a slot in its parent's arrays, which grow
+  // by doubling
+  const std::size_t node_bytes = sizeof(StringSequenceTrieNode) +
+      2 * (sizeof(StringSequenceTrieNode*) + sizeof(WordId));
+  return usage >= m_memory_budget ? 1 : (m_memory_budget - usage) / node_bytes + 1;
+}
+
+void StringSequenceTrie::addSequence(std::string_view sequence) {
+  // the words are added to the forward trie as they're counted, and looked
+  // up again from the back for the backward trie
+  StringSequenceTrieNode* current_seq_node = m_seq_head;
+  std::string_view rest = sequence, word;
+  while (nextWord(&rest, &word)) {
+    WordId id = addWord(word);
+    if (id != kNoWord) current_seq_node = current_seq_node->addChild(id);
+  }
+
+  current_seq_node = m_seq_backward_head;
+  rest = sequence;
+  while (previousWord(&rest, &word)) {
+    WordId id = getWordId(word);
+    if (id != kNoWord) current_seq_node = current_seq_node->addChild(id);
+  }
 }
 
 void StringSequenceTrie::addSequence(const std::vector<std::string> &sequence,
                                      int window_size) {
-  for (int i = 0; i < window_size; i++)
-    m_trie->addWord(sequence[i]);
-
-  for (int i = 0, size = sequence.size(); i < size - window_size; i++) {
-    // m_trie->addWord(sequence[i]);
-    StringSequenceTrieNode* current_sequence_node = m_seq_head;
-    StringTrieNode* current_trie_node = nullptr;
-    for (int k = i; k < i + window_size; k++) {
-      current_trie_node = m_trie->getNode(sequence[k]);
-      if (!current_sequence_node->containsNextWord(current_trie_node)) {
-        current_sequence_node->addChild(current_trie_node);
+  addSequenceHelper(sequence.begin(), sequence.end(), window_size);
+}
+
+void StringSequenceTrie::addSequence(const std::string_view *words,
+                                     std::size_t count, int window_size) {
+  addSequenceHelper(words, words + count, window_size);
+}
+
+template <typename Iterator>
+void StringSequenceTrie::addSequenceHelper(Iterator begin, Iterator end,
+                                           int window_size) {
+  SequenceWindow window(m_seq_head, m_seq_backward_head, window_size);
+  std::size_t budget_check = m_memory_budget == 0 ? SIZE_MAX
+                                                  : enforceMemoryBudget(&window);
+  for (; begin != end; ++begin) {
+    WordId id = addWord(*begin);
+    if (id == kNoWord) continue;
+    window.push(id);
+    if (window.newNodes() >= budget_check)
+      budget_check = enforceMemoryBudget(&window);
+  }
+}
+
+StringSequenceTrie::SequenceWindow::SequenceWindow(
+    StringSequenceTrieNode *forward_head,
+    StringSequenceTrieNode *backward_head, int window_size)
+    : m_forward_head(forward_head), m_backward_head(backward_head),
+      m_cursors(window_size, forward_head), m_words(window_size, kNoWord),
+      m_next(0), m_filled(0), m_new_nodes(0) {}
+
+void StringSequenceTrie::SequenceWindow::push(WordId word) {
+  const std::size_t window_size = m_words.size();
+  m_cursors[m_next] = m_forward_head;
+  m_words[m_next] = word;
+  if (m_filled < window_size) m_filled++;
+
+  // walk newest to oldest. every open forward sequence is extended by word,
+  // and the backward sequence ending at word is added from scratch
+  StringSequenceTrieNode* backward_node = m_backward_head;
+  std::size_t slot = m_next;
+  for (std::size_t i = 0; i < m_filled; i++) {
+    m_cursors[slot] = m_cursors[slot]->addChild(word);
+    backward_node = backward_node->addChild(m_words[slot]);
+    // a node seen once was just created
+    m_new_nodes += (m_cursors[slot]->m_times_seen == 1) +
+                   (backward_node->m_times_seen == 1);
+    slot = (slot == 0 ? window_size : slot) - 1;
+  }
+
+  // the oldest slot now holds a complete window and is reused next
+  if (++m_next == window_size) m_next = 0;
+}
+
+std::string StringSequenceTrie::getNextWord(std::string_view sequence) const {
+  WordId next_word = getNextWordId(sequence);
+  return next_word == kNoWord ? "" : getWord(next_word);
+}
+
+std::string StringSequenceTrie::getPreviousWord(std::string_view sequence) const {
+  std::vector<WordId> context = getWordIds(sequence);
+  std::vector<WordId> previous_words;
+  predictPreviousWords(context.data(), context.size(), &previous_words, 1);
+  return previous_words.empty() ? "" : getWord(previous_words[0]);
+}
+
+std::string StringSequenceTrie::getGapWord(std::string_view left,
+                                           std::string_view right) const {
+  std::vector<WordId> left_ids = getWordIds(left);
+  std::vector<WordId> right_ids = getWordIds(right);
+  std::vector<WordId> gap_words;
+  predictGapWords(left_ids.data(), left_ids.size(), right_ids.data(),
+                  right_ids.size(), &gap_words, 1);
+  return gap_words.empty() ? "" : getWord(gap_words[0]);
+}
+
+WordId StringSequenceTrie::getNextWordId(std::string_view sequence) const {
+  // backs off the same way as predictNextWords, dropping the oldest word
+  // until the rest of the sequence has been followed by a word
+  std::string_view word;
+  do {
+    const StringSequenceTrieNode* current = findSequence(m_seq_head, sequence);
+    StringSequenceTrieNode* top = nullptr;
+    if (current != nullptr && current->m_next_word.getTopChildren(&top, 1) != 0)
+      return top->m_word;
+  } while (nextWord(&sequence, &word));
+  return kNoWord;
+}
+
+int StringSequenceTrie::predictNextWords(const WordId *context,
+    int context_length, std::vector<WordId> *next_words, int limit) const {
+  next_words->clear();
+  for (int start = 0; start <= context_length; start++) {
+    const StringSequenceTrieNode* current = findSequence(
+        m_seq_head, context + start, context_length - start);
+    if (current == nullptr || current->m_next_word.empty()) continue;
+
+    getMostSeenChildren(current, next_words, limit);
+    return context_length - start;
+  }
+  return 0;
+}
+
+int StringSequenceTrie::predictPreviousWords(const WordId *context,
+    int context_length, std::vector<WordId> *previous_words, int limit) const {
+  previous_words->clear();
+  for (int length = context_length; length >= 0; length--) {
+    const StringSequenceTrieNode* current = findSequenceBackward(context, length);
+    if (current == nullptr || current->m_next_word.empty()) continue;
+
+    getMostSeenChildren(current, previous_words, limit);
+    return length;
+  }
+  return 0;
+}
+
+int StringSequenceTrie::predictGapWords(const WordId *left, int left_length,
+    const WordId *right, int right_length, std::vector<WordId> *gap_words,
+    int limit, std::vector<double> *scores) const {
+  gap_words->clear();
+  if (scores != nullptr) scores->clear();
+
+  std::vector<std::pair<double, WordId>> candidates;
+  while (left_length > 0 && right_length > 0) {
+    // before's children are the words seen after left, after's children the
+    // words seen before right, so a gap word must be a child of both
+    const StringSequenceTrieNode* before = findSequence(m_seq_head, left, left_length);
+    const StringSequenceTrieNode* after = findSequenceBackward(right, right_length);
+    if (before != nullptr && after != nullptr) {
+      const bool forward_smaller = before->m_next_word.size() <= after->m_next_word.size();
+      const SequenceChildren &scanned = (forward_smaller ? before : after)->m_next_word;
+      const SequenceChildren &probed = (forward_smaller ? after : before)->m_next_word;
+      // whole sequences that fit in the window were counted directly,
+      // longer ones are estimated from the two halves through the word
+      const bool counted = left_length + 1 + right_length <= m_window_size;
+
+      for (const auto &child : scanned) {
+        const StringSequenceTrieNode* other = probed.find(child.first);
+        if (other == nullptr) continue;
+        const StringSequenceTrieNode* with_left = forward_smaller ? child.second : other;
+        const StringSequenceTrieNode* with_right = forward_smaller ? other : child.second;
+
+        double score = 0;
+        if (counted) {
+          const StringSequenceTrieNode* whole = findSequence(with_left, right, right_length);
+          if (whole != nullptr) score = whole->m_times_seen;
+        } else {
+          // addSequence(string) only adds whole sequences, so the word may
+          // never have started one
+          const StringSequenceTrieNode* word = m_seq_head->m_next_word.find(child.first);
+          if (word != nullptr)
+            score = (double)with_left->m_times_seen * with_right->m_times_seen /
+                    word->m_times_seen;
+        }
+        if (score > 0) candidates.emplace_back(score, child.first);
       }
-      current_sequence_node = current_sequence_node->m_next_word[current_trie_node];
+      if (!candidates.empty()) break;
+    }
+
+    // back off by dropping the word farthest from the gap on the longer side
+    if (left_length >= right_length) {
+      left++;
+      left_length--;
+    } else {
+      right_length--;
+    }
+  }
+
+  if (candidates.empty()) {
+    // one side is used up, so only the other can rank the words
+    int used = right_length == 0
+        ? predictNextWords(left, left_length, gap_words, limit)
+        : predictPreviousWords(right, right_length, gap_words, limit);
+    if (scores != nullptr) {
+      const StringSequenceTrieNode* context = right_length == 0
+          ? findSequence(m_seq_head, left + left_length - used, used)
+          : findSequenceBackward(right, used);
+      for (WordId word : *gap_words)
+        scores->push_back(context->m_next_word.find(word)->m_times_seen);
     }
+    return used;
+  }
+
+  std::size_t size = std::min<std::size_t>(std::max(limit, 0), candidates.size());
+  std::partial_sort(candidates.begin(), candidates.begin() + size, candidates.end(),
+                    [](const std::pair<double, WordId> &first,
+                       const std::pair<double, WordId> &second) {
+    return first.first > second.first;
+  });
+  for (std::size_t i = 0; i < size; i++) {
+    gap_words->push_back(candidates[i].second);
+    if (scores != nullptr) scores->push_back(candidates[i].first);
   }
+  return left_length + right_length;
 }
 
-std::string StringSequenceTrie::getNextWord(std::string &sequence) {
-  StringSequenceTrieNode* current = getNode(sequence);
-  StringSequenceTrieNode* next_word = nullptr;
-  int max = 0;
+void StringSequenceTrie::getMostSeenChildren(const StringSequenceTrieNode *node,
+    std::vector<WordId> *words, int limit) const {
+  if (limit <= static_cast<int>(SequenceChildren::kTopChildren)) {
+    StringSequenceTrieNode* top[SequenceChildren::kTopChildren];
+    std::uint32_t count = node->m_next_word.getTopChildren(top, std::max(limit, 0));
+    for (std::uint32_t i = 0; i < count; i++)
+      words->push_back(top[i]->m_word);
+  } else {
+    std::vector<const StringSequenceTrieNode*> children;
+    for (const auto &next_word : node->m_next_word)
+      children.push_back(next_word.second);
+    std::size_t size = std::min<std::size_t>(limit, children.size());
+    std::partial_sort(children.begin(), children.begin() + size, children.end(),
+                      [](const StringSequenceTrieNode* left,
+                         const StringSequenceTrieNode* right) {
+      return left->m_times_seen > right->m_times_seen;
+    });
+    for (std::size_t i = 0; i < size; i++)
+      words->push_back(children[i]->m_word);
+  }
+}
 
-  for (const auto &pair : current->m_next_word) {
-      if (max < pair.second->getTimesSeen()) {
-          max = max < pair.second->getTimesSeen();
-          next_word = pair.second;
-      }
+std::vector<WordId> StringSequenceTrie::getWordIds(std::string_view sequence) const {
+  std::vector<WordId> ids;
+  std::string_view word;
+  while (nextWord(&sequence, &word)) ids.push_back(getWordId(word));
+  return ids;
+}
+
+StringSequenceTrieNode* StringSequenceTrie::getNode(std::string_view sequence) const {
+  // the trie is only ever reached through this, so dropping const is safe
+  return const_cast<StringSequenceTrieNode*>(findSequence(m_seq_head, sequence));
+}
+
+const StringSequenceTrieNode* StringSequenceTrie::findSequence(
+    const StringSequenceTrieNode *head, std::string_view sequence) const {
+  std::string_view word;
+  while (head != nullptr && nextWord(&sequence, &word)) {
+    WordId id = getWordId(word);
+    head = id == kNoWord ? nullptr : head->m_next_word.find(id);
   }
-  return m_trie->buildStringFromFinalNode(next_word->getWordNode());
+  return head;
 }
 
+const StringSequenceTrieNode* StringSequenceTrie::findSequence(
+    const StringSequenceTrieNode *head, const WordId *words, int length) const {
+  for (int i = 0; i < length && head != nullptr; i++)
+    head = words[i] == kNoWord ? nullptr : head->m_next_word.find(words[i]);
+  return head;
+}
+
+const StringSequenceTrieNode* StringSequenceTrie::findSequenceBackward(
+    const WordId *words, int length) const {
+  const StringSequenceTrieNode* current = m_seq_backward_head;
+  for (int i = length - 1; i >= 0 && current != nullptr; i--)
+    current = words[i] == kNoWord ? nullptr : current->m_next_word.find(words[i]);
+  return current;
+}
+
+struct StringSequenceTrie::OrderedWordsSearch {
+  // orders a heap with the least seen sequence at the front
+  static bool moreSeen(const StringSequenceTrieNode* left,
+                       const StringSequenceTrieNode* right) {
+    return left->m_times_seen > right->m_times_seen;
+  }
+
+  bool isFull() const { return limit != 0 && sequences.size() >= limit; }
+
+  void offer(StringSequenceTrieNode* node) {
+    if (isFull()) {
+      if (node->m_times_seen <= sequences.front()->m_times_seen) return;
+      std::pop_heap(sequences.begin(), sequences.end(), moreSeen);
+      sequences.back() = node;
+    } else {
+      sequences.push_back(node);
+    }
+    std::push_heap(sequences.begin(), sequences.end(), moreSeen);
+  }
+
+  const SequenceCriteria* criteria;
+  std::size_t limit;
+  // heap of the best sequences found so far
+  std::vector<StringSequenceTrieNode*> sequences;
+  // scratch space for sorting children, one per sequence length so the
+  // recursion doesn't allocate
+  std::vector<std::vector<StringSequenceTrieNode*>> children;
+};
+
 std::vector<StringSequenceTrieNode*> StringSequenceTrie::getOrderedWords(
-    const SequenceCriteria & criteria) const {
+    const SequenceCriteria & criteria, int limit) const {
 
   StringSequenceTrieNode* current_node = nullptr;
   if (criteria.m_starting_sequence == "")
@@ -93,51 +581,59 @@ std::vector<StringSequenceTrieNode*> StringSequenceTrie::getOrderedWords(
   else
     current_node = getNode(criteria.m_starting_sequence);
 
-  if (current_node == nullptr) return std::vector<StringSequenceTrieNode*>();
+  if (current_node == nullptr || criteria.m_length_max_count < 1)
+    return std::vector<StringSequenceTrieNode*>();
 
-  std::vector<StringSequenceTrieNode*> sequences;
-  getOrderedWordsHelper(current_node, &sequences, criteria, 1);
+  OrderedWordsSearch search;
+  search.criteria = &criteria;
+  search.limit = std::max(limit, 0);
+  search.sequences.reserve(search.limit);
+  search.children.resize(criteria.m_length_max_count + 1);
+  getOrderedWordsHelper(current_node, &search, 1);
 
-  std::sort(sequences.begin(), sequences.end(),
-            [](const StringSequenceTrieNode* left,
-               const StringSequenceTrieNode* right) {
-    return left->m_times_seen > right->m_times_seen;
-  });
-
-  return sequences;
+  // sorting the heap by its own order puts the most seen first
+  std::sort_heap(search.sequences.begin(), search.sequences.end(),
+                 OrderedWordsSearch::moreSeen);
+  return std::move(search.sequences);
 }
 
 void StringSequenceTrie::getOrderedWordsHelper(
     const StringSequenceTrieNode *current_node,
-    std::vector<StringSequenceTrieNode*> *sequences,
-    const SequenceCriteria & criteria,
+    OrderedWordsSearch *search,
     int current_sequence_length) const {
 
+  const SequenceCriteria &criteria = *search->criteria;
   if (current_sequence_length > criteria.m_length_max_count) return;
 
-  std::vector<StringSequenceTrieNode*> words;
-
+  // a sequence is never seen more often than its prefix, so children below
+  // the minimum frequency can be dropped along with their subtries
+  std::vector<StringSequenceTrieNode*> &words = search->children[current_sequence_length];
+  words.clear();
   for (const auto &next_word : current_node->m_next_word)
-    words.push_back(next_word.second);
+    if (next_word.second->m_times_seen >= criteria.m_frequency_min)
+      words.push_back(next_word.second);
 
   if (words.size() == 0) return;
 
   // sort words by the number of times they have been seen
-  std::sort(words.begin(), words.end(),
-            [](const StringSequenceTrieNode* left,
-               const StringSequenceTrieNode* right) {
-    return left->m_times_seen > right->m_times_seen;
-  });
-
   int size = std::min((int)words.size(), criteria.m_branching_factor);
+  std::partial_sort(words.begin(), words.begin() + size, words.end(),
+                    OrderedWordsSearch::moreSeen);
+
   for (int i = 0; i < size; i++) {
-    getOrderedWordsHelper(words[i], sequences, criteria,
-                          current_sequence_length+1);
+    StringSequenceTrieNode* word = words[i];
+    // neither this word nor any that follow it can displace the current
+    // results, and the remaining words are seen even less
+    if (search->isFull() &&
+        word->m_times_seen <= search->sequences.front()->m_times_seen)
+      break;
+
+    if (current_sequence_length >= criteria.m_length_min_count &&
+        word->m_times_seen <= criteria.m_frequency_max)
+      search->offer(word);
+
+    getOrderedWordsHelper(word, search, current_sequence_length + 1);
   }
-
-  if (current_sequence_length >= criteria.m_length_min_count)
-    std::move(words.begin(), words.begin() + size,
-              std::back_inserter(*sequences));
 }
 
 void StringSequenceTrie::printOrderedWords(const SequenceCriteria &criteria) const {
@@ -152,15 +648,14 @@ void StringSequenceTrie::printOrderedWords(const SequenceCriteria &criteria) con
             << "------|-----------|-------" << std::endl;
 
   for (int i = 0, length = sequences.size(); i < length; i++)
-    if (sequences[i]->m_times_seen >= criteria.m_frequency_min &&
-        sequences[i]->m_times_seen <= criteria.m_frequency_max)
-      std::cout << std::setw(5) << i+1 << std::setw(2) << "|" << std::setw(10)
-                << sequences[i]->m_times_seen << std::setw(2) << "|"
-                << buildSequenceFromFinalNode(sequences[i]) << std::endl;
+    std::cout << std::setw(5) << i+1 << std::setw(2) << "|" << std::setw(10)
+              << sequences[i]->m_times_seen << std::setw(2) << "|"
+              << buildSequenceFromFinalNode(sequences[i]) << std::endl;
 }
 
 void StringSequenceTrie::printMostFrequentSequences(int limit) const {
-  std::vector<StringSequenceTrieNode*> sequences = getOrderedWords(SequenceCriteria());
+  std::vector<StringSequenceTrieNode*> sequences =
+      getOrderedWords(SequenceCriteria(), limit);
   std::cout << "Rank  | Frequency | String" << std::endl
             << "------|-----------|-------" << std::endl;
 
@@ -174,235 +669,458 @@ std::string StringSequenceTrie::buildSequenceFromFinalNode(
     const StringSequenceTrieNode *current) const {
   if (current != m_seq_head) {
     return buildSequenceFromFinalNode(current->m_parent)
-      + m_trie->buildStringFromFinalNode(current->m_trie_word_node) + " ";
+      + getWord(current->m_word) + " ";
   } else {
     return "";
   }
 }
 
-void StringSequenceTrie::writeToFile(std::string filename) const {
-  std::ofstream outfile(filename);
-  if (!outfile.is_open()) {
-    std::cerr << "ERROR: Couldn't open " + filename << std::endl;
-    return;
+// identifies files written by writeToFile, followed by a format version
+static const char kSequenceFileMagic[4] = {'S', 'E', 'Q', 'T'};
+static const unsigned char kSequenceFileVersion = 1;
+// longest sequence readFromFile accepts, bounding its recursion
+static const std::uint64_t kMaxSequenceFileDepth = 4096;
+
+struct StringSequenceTrie::SequenceFileWriter {
+  void writeVarint(std::uint64_t value) {
+    while (value >= 0x80) {
+      buffer.push_back(static_cast<char>((value & 0x7f) | 0x80));
+      value >>= 7;
+    }
+    buffer.push_back(static_cast<char>(value));
   }
 
-  outfile << m_seq_head->m_next_word.size() << std::endl;
-  for(const auto &starting_word : m_seq_head->m_next_word)
-    writeToFileHelper(outfile, starting_word.second);
-
-  outfile.close();
-}
-
-void StringSequenceTrie::writeToFileHelper(std::ofstream &outfile,
-    const StringSequenceTrieNode *current_node) const {
-
-  int current_size = current_node->m_next_word.size();
-  outfile << m_trie->buildStringFromFinalNode(current_node->m_trie_word_node)
-          << " " << current_node->m_times_seen << " " << current_size << " ";
-
-  if (current_size != 0) {
-    for(const auto starting_word : current_node->m_next_word)
-      writeToFileHelper(outfile, starting_word.second);
-  } else {
-    outfile << std::endl;
+  std::string buffer;
+  // length of the longest sequence written
+  int max_depth = 0;
+  // children of the nodes being written sorted by word id, one list per
+  // depth so the recursion doesn't allocate
+  std::vector<std::vector<std::pair<WordId, const StringSequenceTrieNode*>>> children;
+};
+
+struct StringSequenceTrie::SequenceFileReader {
+  // sets failed and returns 0 when the varint runs past the end
+  std::uint64_t readVarint() {
+    std::uint64_t value = 0;
+    for (int shift = 0; shift < 64 && position < end; shift += 7) {
+      unsigned char byte = *position++;
+      value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) return value;
+    }
+    failed = true;
+    return 0;
   }
-}
 
-//void StringSequenceTrie::sequenceAdder() {
-//  while(true) {
-//    if(word_queue.size() > m_window_size) {
-//      auto it = word_queue.begin();
-//      std::advance(it, m_window_size);
-//      std::string str;
-//      str.append(word_queue.begin(), it);
-//    }
-//  }
-//}
+  const unsigned char* position;
+  const unsigned char* end;
+  bool failed;
+  int max_depth;
+  // word ids in the file to word ids in this trie
+  std::vector<WordId> word_ids;
+};
 
-void StringSequenceTrie::readFromFile(std::string filename) {
-  std::ifstream infile(filename);
-  if (!infile.is_open()) {
-    std::cout << "ERROR: Couldn't open " + filename << std::endl;
-    return;
+bool StringSequenceTrie::writeToFile(std::string filename) const {
+  std::ofstream outfile(filename, std::ios::binary);
+  if (!outfile.is_open()) {
+    std::cerr << "ERROR: Couldn't open " + filename << std::endl;
+    return false;
   }
-  int branches = 0;
-  infile >> branches;
-  for (int i = 0; i < branches; i++)
-    readFromFileHelper(infile, m_seq_head);
-
-  infile.close();
-}
-
-void StringSequenceTrie::readFromFileHelper(std::ifstream &infile,
-                      StringSequenceTrieNode *current_seq_node) {
-
-  // read in one node from file
-  int current_frequency = 0, current_branches = 0;
-  std::string current_str;
-  infile >> current_str >> current_frequency >> current_branches;
 
-  // add word to trie if not already there
-  if (!m_trie->contains(current_str)) m_trie->addWord(current_str);
-
-  // get pointer to word
-  StringTrieNode* current_trie_node = m_trie->getNode(current_str);
+  SequenceFileWriter writer;
+  // vocabulary, words are numbered by their position. a word's count is
+  // the count of the one word sequence starting with it
+  writer.writeVarint(m_vocabulary.size());
+  for (WordId word = 0; word < m_vocabulary.size(); word++) {
+    std::string text = getWord(word);
+    StringSequenceTrieNode* first_word = m_seq_head->m_next_word.find(word);
+    writer.writeVarint(text.size());
+    writer.buffer.append(text);
+    writer.writeVarint(first_word == nullptr ? 0 : first_word->m_times_seen);
+  }
 
-  if (!current_seq_node->containsNextWord(current_trie_node))
-    current_seq_node->addChild(current_trie_node);
+  writeToFileHelper(&writer, m_seq_head, 0);
+  writeToFileHelper(&writer, m_seq_backward_head, 0);
 
-  current_seq_node->addTimesSeen(current_frequency - 1);
+  // the header needs the depth, so it is written after the tries
+  SequenceFileWriter header;
+  header.buffer.append(kSequenceFileMagic, sizeof(kSequenceFileMagic));
+  header.buffer.push_back(kSequenceFileVersion);
+  header.writeVarint(m_window_size);
+  header.writeVarint(writer.max_depth);
+  header.writeVarint(m_total_words);
 
-  //recursively call self on all child nodes
-  for (int i = 0; i < current_branches; i++)
-    readFromFileHelper(infile, current_seq_node->m_next_word[current_trie_node]);
+  outfile.write(header.buffer.data(), header.buffer.size());
+  outfile.write(writer.buffer.data(), writer.buffer.size());
+  outfile.close();
+  return !outfile.fail();
 }
 
-
-void StringSequenceTrie::addSequenceHelper(const std::string &sequence,
-    StringSequenceTrieNode* current_seq_node, std::size_t starting_pos) {
-
-  // get the first word in the sequence
-  std::size_t size = sequence.size();
-  std::size_t space_index = sequence.find(" ", starting_pos);
-  std::string str = "";
-  if (space_index < size) {
-    str = sequence.substr(starting_pos, space_index - starting_pos);
-  } else {
-    str = sequence.substr(starting_pos, size - starting_pos);
-  }
-
-  m_trie->addWord(str);
-  StringTrieNode* current_trie_node = m_trie->getNode(str);
-
-  if (!current_seq_node->containsNextWord(current_trie_node)) {
-    current_seq_node->addChild(current_trie_node);
+void StringSequenceTrie::writeToFileHelper(SequenceFileWriter *writer,
+    const StringSequenceTrieNode *current_node, int depth) const {
+
+  if ((int)writer->children.size() <= depth) writer->children.resize(depth + 1);
+  writer->max_depth = std::max(writer->max_depth, depth);
+  // the recursion may grow writer->children, so it is indexed every time
+  // rather than held by reference
+  writer->children[depth].assign(current_node->m_next_word.begin(),
+                                 current_node->m_next_word.end());
+  // sorted siblings give small deltas between their ids
+  std::sort(writer->children[depth].begin(), writer->children[depth].end());
+
+  std::size_t size = writer->children[depth].size();
+  writer->writeVarint(size);
+  WordId previous_word = 0;
+  for (std::size_t i = 0; i < size; i++) {
+    const StringSequenceTrieNode* child = writer->children[depth][i].second;
+    writer->writeVarint(child->m_word - previous_word);
+    writer->writeVarint(child->m_times_seen);
+    previous_word = child->m_word;
+    writeToFileHelper(writer, child, depth + 1);
   }
-
-  if (space_index >= size) return;
-
-  // add sequence of words starting after current word
-  addSequenceHelper(sequence, current_seq_node->m_next_word[current_trie_node],
-                    space_index + 1);
 }
 
-void StringSequenceTrie::addSequenceBackwardHelper(
-    const std::string &sequence,
-    StringSequenceTrieNode *current_seq_node,
-    std::size_t starting_pos) {
-  // get the first word in the sequence
-  std::size_t space_index = sequence.rfind(" ", starting_pos);
-  std::string str = "";
-
-  if (space_index < starting_pos) {
-    str = sequence.substr(space_index + 1, starting_pos - space_index);
-  } else {
-    str = sequence.substr(0, starting_pos);
+bool StringSequenceTrie::readFromFile(std::string filename) {
+  MappedFile file(filename);
+  if (!file.isOpen()) {
+    std::cerr << "ERROR: Couldn't open " + filename << std::endl;
+    return false;
   }
 
-  //m_trie->addWord(str);
-  StringTrieNode* current_trie_node = m_trie->getNode(str);
+  SequenceFileReader reader;
+  reader.position = reinterpret_cast<const unsigned char*>(file.data());
+  reader.end = reader.position + file.size();
+  reader.failed = false;
+
+  if (file.size() < sizeof(kSequenceFileMagic) + 1 ||
+      !std::equal(kSequenceFileMagic, kSequenceFileMagic + sizeof(kSequenceFileMagic),
+                  file.data()) ||
+      file.data()[sizeof(kSequenceFileMagic)] != kSequenceFileVersion) {
+    std::cerr << "ERROR: " + filename + " is not a sequence trie file" << std::endl;
+    return false;
+  }
+  reader.position += sizeof(kSequenceFileMagic) + 1;
+
+  std::uint64_t window_size = reader.readVarint();
+  std::uint64_t max_depth = reader.readVarint();
+  std::uint64_t total_words = reader.readVarint();
+  std::uint64_t vocabulary_size = reader.readVarint();
+  // every word takes at least two bytes, which bounds a corrupt size
+  if (reader.failed || window_size > INT32_MAX || total_words > INT32_MAX ||
+      max_depth > kMaxSequenceFileDepth ||
+      vocabulary_size > (std::uint64_t)(reader.end - reader.position) / 2) {
+    std::cerr << "ERROR: " + filename + " is malformed" << std::endl;
+    return false;
+  }
 
-  if (!current_seq_node->containsNextWord(current_trie_node)) {
-    current_seq_node->addChild(current_trie_node);
+  reader.word_ids.reserve(vocabulary_size);
+  std::string word;
+  for (std::uint64_t i = 0; i < vocabulary_size && !reader.failed; i++) {
+    std::uint64_t length = reader.readVarint();
+    if (length > (std::uint64_t)(reader.end - reader.position)) {
+      reader.failed = true;
+      break;
+    }
+    word.assign(reinterpret_cast<const char*>(reader.position), length);
+    reader.position += length;
+    std::uint64_t occurences = reader.readVarint();
+    if (occurences > INT32_MAX) reader.failed = true;
+    else reader.word_ids.push_back(addWord(word, occurences));
   }
 
-  if (space_index >= starting_pos) return;
+  m_window_size = std::max(m_window_size, (int)window_size);
+  m_total_words += total_words;
+  reader.max_depth = max_depth;
+  if (!reader.failed) readFromFileHelper(&reader, m_seq_head, 0);
+  if (!reader.failed) readFromFileHelper(&reader, m_seq_backward_head, 0);
 
-  // add sequence of words starting after current word
-  addSequenceBackwardHelper(sequence, current_seq_node->m_next_word[current_trie_node],
-                            space_index - 1);
+  if (reader.failed || reader.position != reader.end) {
+    std::cerr << "ERROR: " + filename + " is malformed" << std::endl;
+    return false;
+  }
+  return true;
 }
 
-StringSequenceTrieNode* StringSequenceTrie::getNode(const std::string &sequence) const {
-  StringSequenceTrieNode* current_record_node = m_seq_head;
-  std::size_t space_index = 0, size = 0;
-  int current_pos = 0;
+bool StringSequenceTrie::readFromFileHelper(SequenceFileReader *reader,
+    StringSequenceTrieNode *current_seq_node, int depth) {
 
-  do {
-    // find the next space in the sentence
-    std::size_t space_index = sequence.find(" ", current_pos);
-    std::size_t size = sequence.size();
+  std::uint64_t branches = reader->readVarint();
+  // each child takes at least three bytes, and no sequence is longer than
+  // the header says, which keeps a corrupt file from running away
+  if (reader->failed || (branches != 0 && depth >= reader->max_depth) ||
+      branches > (std::uint64_t)(reader->end - reader->position) / 3) {
+    reader->failed = true;
+    return false;
+  }
 
-    // check and verify there is a space in the string, else return
-    std::string str;
-    if (space_index < size)
-      str = sequence.substr(current_pos, space_index - current_pos);
-    else
-      str = sequence.substr(current_pos, size - current_pos);
+  std::uint64_t current_word = 0;
+  for (std::uint64_t i = 0; i < branches; i++) {
+    current_word += reader->readVarint();
+    std::uint64_t current_frequency = reader->readVarint();
+    if (reader->failed || current_word >= reader->word_ids.size() ||
+        reader->word_ids[current_word] == kNoWord ||
+        current_frequency > INT32_MAX) {
+      reader->failed = true;
+      return false;
+    }
 
-    current_pos = space_index + 1;
+    StringSequenceTrieNode* next_seq_node = current_seq_node->addChild(
+        reader->word_ids[current_word], current_frequency);
 
-    // check if the word is in m_trie
-    // if it is not, then it wouldn't be in the sequence record
-    StringTrieNode* current_trie_node = m_trie->getNode(str);
-    if (current_trie_node == nullptr) return nullptr;
+    //recursively call self on all child nodes
+    if (!readFromFileHelper(reader, next_seq_node, depth + 1)) return false;
+  }
+  return true;
+}
 
-    if (!current_record_node->containsNextWord(current_trie_node))
-      return nullptr;
-    else
-      current_record_node = current_record_node->m_next_word[current_trie_node];
-  } while (space_index < size);
 
-  return current_record_node;
-}
+void StringSequenceTrie::addText(std::string_view text, int window_size) {
+  std::vector<std::string_view> words;
+  std::string buffer;
+  m_token_pipeline.tokenize(text, &words, &buffer);
+  m_window_size = window_size;
 
-bool isPunctNotPeriod(const char &c) {
-  return (std::ispunct(c) && c != '.') ? true : false;
+  SequenceWindow window(m_seq_head, m_seq_backward_head, window_size);
+  std::size_t budget_check = m_memory_budget == 0 ? SIZE_MAX
+                                                  : enforceMemoryBudget(&window);
+  pushWords(words, &window, &budget_check);
 }
 
-void cleanString(std::string &str) {
-  std::string output;
-  std::remove_copy_if(str.begin(), str.end(), std::back_inserter(output),
-                      std::ptr_fun(isPunctNotPeriod));
-  str.assign(std::move(output));
+void StringSequenceTrie::pushWords(const std::vector<std::string_view> &words,
+                                   SequenceWindow *window,
+                                   std::size_t *budget_check) {
+  // each word is looked up once, then pushed through a window of the last
+  // window_size words
+  for (std::string_view temp_word : words) {
+    if (TokenPipeline::isBreak(temp_word)) {
+      window->reset();
+      continue;
+    }
+    WordId word = addWord(temp_word);
+    if (word == kNoWord) continue;
+    window->push(word);
+    m_total_words++;
+    if (window->newNodes() >= *budget_check)
+      *budget_check = enforceMemoryBudget(window);
+  }
 }
 
 void StringSequenceTrie::loadTextFile(std::string file_name, int window_size) {
   if (file_name == "") file_name = "books/Mark_Twain_LifeOnTheMississippi.txt";
   else file_name = "books/" + file_name;
-  std::ifstream my_file;
-  my_file.open(file_name);
+  CorpusReader reader(file_name);
 
-  if(!my_file.is_open())
+  if(!reader.isOpen())
     std::cerr << "ERROR: " << file_name << " didn't open!\n";
 
   std::cout << "Now Loading " << file_name << "...\n";
 
-  std::string temp_word;
+  std::vector<std::string_view> words;
   std::clock_t start = clock();
-  std::string sequence = "";
-
-  int count = 1;
-  my_file >> sequence;
-  // Add 5 words in queue together and add sequence to StringSequenceTrie
-  while (!my_file.eof() && count < window_size){
-    my_file >> temp_word;
-    cleanString(temp_word);
-    if (temp_word != "" && temp_word != " ") {
-      sequence += " " + temp_word;
-      count++;
+  m_window_size = window_size;
+
+  SequenceWindow window(m_seq_head, m_seq_backward_head, window_size);
+  std::size_t budget_check = m_memory_budget == 0 ? SIZE_MAX
+                                                  : enforceMemoryBudget(&window);
+  while (reader.nextBatch(&words, &m_token_pipeline))
+    pushWords(words, &window, &budget_check);
+  double duration = (clock() - start) / (double)CLOCKS_PER_SEC;
+  std::cout << "Time taken: " << duration  << " seconds" << std::endl;
+  std::cout << "Sequence nodes: " << getNumberNodes() << ", "
+            << memoryUsage() / 1024 << " KB" << std::endl;
+}
+
+struct StringSequenceTrie::SequenceWorker {
+  SequenceWorker() : forward_head(kNoWord, nullptr),
+                     backward_head(kNoWord, nullptr), total_words(0) {}
+
+  StringSequenceTrieNode forward_head;
+  StringSequenceTrieNode backward_head;
+  // ids of the words this worker has already looked up, so the shared
+  // dictionary is only locked the first time a worker sees a word
+  std::unordered_map<std::string, WordId> word_cache;
+  // occurences counted by this worker, indexed by word id
+  std::vector<int> word_counts;
+  int total_words;
+};
+
+// true if position is whitespace directly after the end of a sentence
+static bool isSentenceBoundary(std::string_view text, std::size_t position) {
+  if (position == 0 || !std::isspace(static_cast<unsigned char>(text[position])))
+    return false;
+  char last = text[position - 1];
+  return last == '.' || last == '!' || last == '?';
+}
+
+void StringSequenceTrie::loadTextFiles(const std::vector<std::string> &file_names,
+                                       int window_size, int thread_count) {
+  if (thread_count <= 0)
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  auto start = std::chrono::steady_clock::now();
+  m_window_size = window_size;
+
+  // the files stay mapped until every chunk has been counted
+  std::vector<std::unique_ptr<CorpusReader>> readers;
+  std::size_t total_size = 0;
+  for (const std::string &name : file_names) {
+    std::string file_name = "books/" + name;
+    std::unique_ptr<CorpusReader> reader(new CorpusReader(file_name));
+    if (!reader->isOpen()) {
+      std::cerr << "ERROR: " << file_name << " didn't open!\n";
+      continue;
     }
+    std::cout << "Now Loading " << file_name << "...\n";
+    total_size += reader->getText().size();
+    readers.push_back(std::move(reader));
   }
 
-  addSequence(sequence);
+  // several chunks per thread so that threads finishing early can help out
+  const std::size_t chunk_size = std::max<std::size_t>(
+      total_size / (thread_count * 8), 1 << 16);
+  std::vector<std::string_view> chunks;
+  for (const std::unique_ptr<CorpusReader> &reader : readers) {
+    std::string_view text = reader->getText();
+    std::size_t begin = 0;
+    while (begin < text.size()) {
+      std::size_t end = std::min(begin + chunk_size, text.size());
+      while (end < text.size() && !isSentenceBoundary(text, end)) end++;
+      chunks.push_back(text.substr(begin, end - begin));
+      begin = end;
+    }
+  }
 
-  while (!my_file.eof()) {
-    my_file >> temp_word;
-    cleanString(temp_word);
-    if(temp_word != ""){
-      size_t space = sequence.find(" ");
-      sequence.erase(0, space + 1);
-      sequence += " " + temp_word;
-      addSequence(sequence);
+  std::vector<SequenceWorker> workers(thread_count);
+  std::vector<std::thread> threads;
+  std::atomic<std::size_t> next_chunk(0);
+  for (int i = 0; i < thread_count; i++)
+    threads.emplace_back(&StringSequenceTrie::countChunks, this, &workers[i],
+                         std::cref(chunks), &next_chunk, window_size);
+  for (std::thread &thread : threads) thread.join();
+  threads.clear();
+
+  // every first word is added up front, then each thread merges the
+  // subtries under a disjoint set of first words so no locking is needed
+  for (SequenceWorker &worker : workers) {
+    for (const auto &next_word : worker.forward_head.m_next_word) {
+      StringSequenceTrieNode*& child = m_seq_head->m_next_word.findOrInsert(next_word.first);
+      if (child == nullptr) child = new StringSequenceTrieNode(next_word.first, m_seq_head);
+    }
+    for (const auto &next_word : worker.backward_head.m_next_word) {
+      StringSequenceTrieNode*& child = m_seq_backward_head->m_next_word.findOrInsert(next_word.first);
+      if (child == nullptr) child = new StringSequenceTrieNode(next_word.first, m_seq_backward_head);
     }
   }
-  double duration = (clock() - start) / (double)CLOCKS_PER_SEC;
-  std::cout << "Time taken: " << duration  << " seconds" << std::endl;
-  my_file.close();
+
+  for (int i = 0; i < thread_count; i++) {
+    threads.emplace_back([this, i, thread_count, &workers]() {
+      for (SequenceWorker &worker : workers) {
+        const std::pair<StringSequenceTrieNode*, StringSequenceTrieNode*> heads[] = {
+          {m_seq_head, &worker.forward_head},
+          {m_seq_backward_head, &worker.backward_head}};
+        for (const auto &head : heads) {
+          for (const auto &next_word : head.second->m_next_word) {
+            if (next_word.first % thread_count != static_cast<WordId>(i)) continue;
+            // the heads' cached lists are shared, they're rebuilt afterwards
+            StringSequenceTrieNode* into = head.first->m_next_word.find(next_word.first);
+            into->addTimesSeen(next_word.second->m_times_seen);
+            mergeSequenceNode(into, next_word.second);
+            delete next_word.second;
+          }
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads) thread.join();
+  m_seq_head->m_next_word.rebuildTop();
+  m_seq_backward_head->m_next_word.rebuildTop();
+  // workers don't share their tries until the end, so the budget is only
+  // applied to the merged result
+  if (m_memory_budget != 0 && memoryUsage() > m_memory_budget)
+    compactToBudget(m_memory_budget);
+
+  for (SequenceWorker &worker : workers) {
+    worker.forward_head.m_next_word.clear();
+    worker.backward_head.m_next_word.clear();
+
+    for (WordId id = 0; id < worker.word_counts.size(); id++) {
+      if (worker.word_counts[id] == 0) continue;
+      m_trie->m_record->addWord(m_vocabulary[id], worker.word_counts[id]);
+      m_trie->number_of_total_words += worker.word_counts[id];
+    }
+    m_total_words += worker.total_words;
+  }
+
+  std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+  std::cout << "Time taken: " << duration.count() << " seconds using "
+            << thread_count << " threads" << std::endl;
+  std::cout << "Sequence nodes: " << getNumberNodes() << ", "
+            << memoryUsage() / 1024 << " KB" << std::endl;
+}
+
+void StringSequenceTrie::countChunks(SequenceWorker *worker,
+                                     const std::vector<std::string_view> &chunks,
+                                     std::atomic<std::size_t> *next_chunk,
+                                     int window_size) {
+  std::vector<std::string_view> words;
+  std::string buffer, word;
+  std::size_t index = 0;
+  while ((index = next_chunk->fetch_add(1)) < chunks.size()) {
+    words.clear();
+    m_token_pipeline.tokenize(chunks[index], &words, &buffer);
+
+    // windows don't carry over between chunks, they start at a new sentence
+    SequenceWindow window(&worker->forward_head, &worker->backward_head,
+                          window_size);
+    for (std::string_view view : words) {
+      if (TokenPipeline::isBreak(view)) {
+        window.reset();
+        continue;
+      }
+      // reused for every cache lookup, so it stops allocating once grown
+      word.assign(view);
+
+      WordId id = kNoWord;
+      auto cached = worker->word_cache.find(word);
+      if (cached != worker->word_cache.end()) {
+        id = cached->second;
+      } else {
+        id = addWordShared(word);
+        if (id == kNoWord) continue;
+        worker->word_cache.emplace(word, id);
+      }
+
+      if (id >= worker->word_counts.size()) worker->word_counts.resize(id + 1, 0);
+      worker->word_counts[id]++;
+      worker->total_words++;
+      window.push(id);
+    }
+  }
+}
+
+WordId StringSequenceTrie::addWordShared(const std::string &word) {
+  std::lock_guard<std::mutex> lock(m_vocabulary_mutex);
+  return addWord(word, 0);
+}
+
+void StringSequenceTrie::mergeSequenceNode(StringSequenceTrieNode *into,
+                                           StringSequenceTrieNode *from) {
+  for (const auto &next_word : from->m_next_word) {
+    StringSequenceTrieNode*& child = into->m_next_word.findOrInsert(next_word.first);
+    if (child == nullptr) {
+      // sequence is new to into, so the whole subtrie can be moved over
+      child = next_word.second;
+      child->m_parent = into;
+      into->m_next_word.updateTop(child);
+    } else {
+      child->addTimesSeen(next_word.second->m_times_seen);
+      into->m_next_word.updateTop(child);
+      mergeSequenceNode(child, next_word.second);
+      delete next_word.second;
+    }
+  }
+  from->m_next_word.clear();
 }
 
-void StringSequenceTrie::SequenceCriteria::setStartingSequence(std::string starting_sequence) {
+void StringSequenceTrie::SequenceCriteria::setStartingSequence(std::string_view starting_sequence) {
   m_starting_sequence = starting_sequence;
   for(int i = 0, size = starting_sequence.size() - 1; i < size; i++) {
     if (starting_sequence[i+1] == ' ') {
@@ -37,13 +37,15 @@
 #include <iomanip>
 
 StringTrieNode::StringTrieNode(const char &input_char)
-    : data(input_char), is_a_word(false), parent(nullptr), m_paths() {}
+    : data(input_char), is_a_word(false), word_id(UINT32_MAX), parent(nullptr),
+      m_paths() {}
 
 StringTrieNode::~StringTrieNode() {}
 
 void StringTrie::removeSubTrie(StringTrieNode* current) {
-  for (std::pair<const char, StringTrieNode*> &pair : current->m_paths)
-    removeSubTrie(pair.second);
+  // each child erases itself from m_paths, so always take the first one
+  while (!current->m_paths.empty())
+    removeSubTrie(current->m_paths.begin()->second);
 
   if (current->is_a_word) {
     number_of_total_words -= m_record->getNumberOccurences(current);
@@ -63,6 +65,7 @@ StringTrie::StringTrie() {
 
 StringTrie::~StringTrie() {
   removeSubTrie(head);
+  delete m_record;
 }
 
 void StringTrie::resetTrie() {
@@ -74,13 +77,16 @@ void StringTrie::resetTrie() {
   number_of_unique_words = 0;
 }
 
-void StringTrie::addWord(const std::string &word) {
-  if (word == "" || word == " ") return;
+void StringTrie::addWord(std::string_view word) {
+  insertWord(word);
+}
+
+StringTrieNode* StringTrie::insertWord(std::string_view word, int occurences) {
+  if (word == "" || word == " ") return nullptr;
 
   StringTrieNode* current_node = head;
-  const char* c_string_word = word.c_str();
   for (int i = 0, length = word.length(); i < length; i++) {
-    char key_char = tolower(c_string_word[i]);
+    char key_char = tolower(word[i]);
     if (!current_node->hasSuffixNode(key_char)) {
       current_node->m_paths[key_char] = new StringTrieNode(key_char);
       current_node->m_paths[key_char]->parent = current_node;
@@ -90,9 +96,10 @@ void StringTrie::addWord(const std::string &word) {
 
   if (!current_node->is_a_word) number_of_unique_words +=1;
   current_node->is_a_word = true;
-  number_of_total_words += 1;
+  number_of_total_words += occurences;
 
-  m_record->addWord(current_node);
+  m_record->addWord(current_node, occurences);
+  return current_node;
 }
 
 bool StringTrie::contains(const std::string &word) {
@@ -318,12 +325,11 @@ std::string StringTrie::buildStringFromFinalNode(const StringTrieNode* current_n
 
 // returns a pointer to the StringTrieNode corresponding with the last character
 // of the string word. If word is not in the trie, a nullptr is returned
-StringTrieNode *StringTrie::getNode(const std::string &word) {
+StringTrieNode *StringTrie::getNode(std::string_view word) {
   StringTrieNode* current_node = head;
-  const char* c_string_word = word.c_str();
   char key_char = '\0';
   for (int i = 0, length = word.length(); i < length; i++) {
-    key_char = tolower(c_string_word[i]);
+    key_char = tolower(word[i]);
     current_node = current_node->getSuffixNode(key_char);
     if (current_node == nullptr) return nullptr;
   }
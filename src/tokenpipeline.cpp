@@ -0,0 +1,116 @@
+/************************************************************************************
+**                                                                                 **
+**  MIT License                                                                    **
+**                                                                                 **
+**  Copyright (c) 2017 Lucas Frey                                                  **
+**                                                                                 **
+**  Permission is hereby granted, free of charge, to any person obtaining          **
+**  a copy of this software and associated documentation files (the "Software"),   **
+**  to deal in the Software without restriction, including without limitation      **
+**  the rights to use, copy, modify, merge, publish, distribute, sublicense,       **
+**  and/or sell copies of the Software, and to permit persons to whom the          **
+**  Software is furnished to do so, subject to the following conditions:           **
+**                                                                                 **
+**  The above copyright notice and this permission notice shall be included        **
+**  in all copies or substantial portions of the Software.                         **
+**                                                                                 **
+**  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS        **
+**  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    **
+**  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    **
+**  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         **
+**  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  **
+**  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  **
+**  SOFTWARE.                                                                      **
+**                                                                                 **
+************************************************************************************/
+#include "tokenpipeline.h"
+
+#include <algorithm>
+
+#include "corpusreader.h"
+
+TokenPipeline::TokenPipeline() : m_split_sentences(true), m_longest_word(0) {
+  const char* abbreviations[] = {"mr", "mrs", "ms", "messrs", "dr", "st",
+                                 "jr", "sr"};
+  for (const char* abbreviation : abbreviations) addAbbreviation(abbreviation);
+}
+
+void TokenPipeline::addAbbreviation(std::string_view word) {
+  addWord(word, kKeepWord, true);
+}
+
+void TokenPipeline::addStopWord(std::string_view word) {
+  addWord(word, kSkipWord, false);
+}
+
+void TokenPipeline::addBlackListWord(std::string_view word) {
+  addWord(word, kEndSequence, false);
+}
+
+void TokenPipeline::addWord(std::string_view word, Action action,
+                            bool abbreviation) {
+  // cleaned the same way as the text, so "Don't" matches "dont"
+  std::string key(word);
+  CorpusReader::cleanWord(&key);
+  while (!key.empty() && key.back() == '.') key.pop_back();
+  if (key.empty()) return;
+
+  WordRule &rule = m_words[key];
+  rule.action = action;
+  rule.abbreviation = abbreviation;
+  m_longest_word = std::max(m_longest_word, key.size());
+}
+
+TokenPipeline::Action TokenPipeline::apply(std::string_view* word,
+                                           bool* abbreviation) const {
+  *abbreviation = false;
+  if (word->size() <= m_longest_word) {
+    // longer words can't be in the lists, so no key is built for them
+    auto found = m_words.find(std::string(*word));
+    if (found != m_words.end()) {
+      if (found->second.action != kKeepWord) return found->second.action;
+      *abbreviation = found->second.abbreviation;
+    }
+  }
+
+  for (const Stage &stage : m_stages) {
+    Action action = stage(word);
+    if (action != kKeepWord) return action;
+    if (word->empty()) return kSkipWord;
+  }
+  return kKeepWord;
+}
+
+void TokenPipeline::tokenize(std::string_view text,
+                             std::vector<std::string_view>* words,
+                             std::string* buffer) const {
+  const std::size_t begin = words->size();
+  CorpusReader::tokenize(text, words, buffer, m_split_sentences);
+  if (m_words.empty() && m_stages.empty()) return;
+
+  // filter the new words in place, merging breaks that end up together
+  std::size_t kept = begin;
+  bool after_abbreviation = false;
+  for (std::size_t i = begin; i < words->size(); i++) {
+    std::string_view word = (*words)[i];
+    Action action = kEndSequence;
+    if (isBreak(word)) {
+      // the period of an abbreviation doesn't end the sentence
+      if (after_abbreviation) {
+        after_abbreviation = false;
+        continue;
+      }
+    } else {
+      action = apply(&word, &after_abbreviation);
+    }
+
+    if (action == kSkipWord) continue;
+    if (action == kEndSequence) {
+      after_abbreviation = false;
+      if (kept > begin && isBreak((*words)[kept - 1])) continue;
+      word = std::string_view();
+    }
+    (*words)[kept++] = word;
+  }
+  words->resize(kept);
+}
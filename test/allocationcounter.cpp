@@ -0,0 +1,33 @@
+#include "allocationcounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// the replacements live in their own translation unit so no test sees
+// their definitions, and they only count while an AllocationCounter exists
+static std::atomic<bool> counting(false);
+static std::atomic<std::size_t> allocations(0);
+
+AllocationCounter::AllocationCounter() {
+    allocations.store(0);
+    counting.store(true);
+}
+
+AllocationCounter::~AllocationCounter() {
+    counting.store(false);
+}
+
+std::size_t AllocationCounter::count() const {
+    return allocations.load();
+}
+
+void* operator new(std::size_t size) {
+    if (counting.load(std::memory_order_relaxed))
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
@@ -0,0 +1,21 @@
+#ifndef ALLOCATIONCOUNTER_H_
+#define ALLOCATIONCOUNTER_H_
+
+#include <cstddef>
+
+// counts the heap allocations made through operator new while it's in
+// scope, so a test can check that a call doesn't allocate. Allocations are
+// only counted while a counter exists, and only one should exist at a time
+class AllocationCounter {
+public:
+    AllocationCounter();
+    ~AllocationCounter();
+
+    AllocationCounter(const AllocationCounter&) = delete;
+    AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+    // returns the number of allocations since the counter was made
+    std::size_t count() const;
+};
+
+#endif  // ALLOCATIONCOUNTER_H_
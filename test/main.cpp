@@ -1,4 +1,8 @@
 #include "teststringtrie.h"
+#include "teststringsequencetrie.h"
+#include "testsequencesuffixarray.h"
+#include "testlinkedlist.h"
+#include "testskiplist.h"
 
 #include <gtest/gtest.h>
 
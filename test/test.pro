@@ -1,13 +1,44 @@
 include(gtest_dependency.pri)
 
 TEMPLATE = app
-CONFIG += console c++11
+CONFIG += console c++17
 CONFIG -= app_bundle
 CONFIG += thread
 CONFIG -= qt
 
 HEADERS +=     teststringtrie.h \
-    ../include/stringtrie.h
+    teststringsequencetrie.h \
+    testsequencesuffixarray.h \
+    testlinkedlist.h \
+    testskiplist.h \
+    allocationcounter.h \
+    ../include/concurrentqueue.h \
+    ../include/concurrentsequencetrie.h \
+    ../include/concurrentskiplist.h \
+    ../include/corpusreader.h \
+    ../include/epochreclaimer.h \
+    ../include/intrusivelist.h \
+    ../include/linkedlist.h \
+    ../include/mappedfile.h \
+    ../include/sequencechildren.h \
+    ../include/sequencegenerator.h \
+    ../include/sequencelanguagemodel.h \
+    ../include/sequencesuffixarray.h \
+    ../include/skiplist.h \
+    ../include/stringsequencetrie.h \
+    ../include/stringtrie.h \
+    ../include/tokenpipeline.h \
+    ../include/unrolledlinkedlist.h
 
 SOURCES +=     main.cpp \
-    ../src/stringtrie.cpp
+    allocationcounter.cpp \
+    ../src/concurrentsequencetrie.cpp \
+    ../src/corpusreader.cpp \
+    ../src/mappedfile.cpp \
+    ../src/sequencechildren.cpp \
+    ../src/sequencegenerator.cpp \
+    ../src/sequencelanguagemodel.cpp \
+    ../src/sequencesuffixarray.cpp \
+    ../src/stringsequencetrie.cpp \
+    ../src/stringtrie.cpp \
+    ../src/tokenpipeline.cpp
@@ -0,0 +1,556 @@
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "../include/concurrentqueue.h"
+#include "../include/intrusivelist.h"
+#include "../include/linkedlist.h"
+#include "../include/unrolledlinkedlist.h"
+
+using namespace testing;
+
+// runs the same random inserts and removes on list and a vector
+template<class List, class T, class MakeValue>
+static void checkAgainstVector(List* list, MakeValue make_value, int operations) {
+    std::vector<T> expected;
+    std::srand(7);
+    for (int i = 0; i < operations; i++) {
+        T value = make_value(i);
+        int length = expected.size();
+        int index = length == 0 ? 0 : std::rand() % (length + 1);
+        switch (std::rand() % 6) {
+            case 0: list->insertStart(value); expected.insert(expected.begin(), value); break;
+            case 1: list->insertEnd(value); expected.push_back(value); break;
+            case 2: case 3:
+                list->insertAt(value, index);
+                expected.insert(expected.begin() + std::min(index, length), value);
+                break;
+            case 4:
+                if (length == 0) break;
+                index = std::min(index, length - 1);
+                ASSERT_EQ(expected[index], list->removeAt(index));
+                expected.erase(expected.begin() + index);
+                break;
+            case 5:
+                if (length == 0) break;
+                ASSERT_EQ(expected.back(), list->removeLast());
+                expected.pop_back();
+                break;
+        }
+        ASSERT_EQ((int)expected.size(), list->getLength());
+    }
+    for (int i = 0; i < (int)expected.size(); i++)
+        ASSERT_EQ(expected[i], list->getItemAt(i));
+    if (!expected.empty()) {
+        EXPECT_EQ(expected.front(), list->getFirst());
+        EXPECT_EQ(expected.back(), list->getLast());
+        EXPECT_TRUE(list->contains(expected[expected.size() / 2]));
+    }
+}
+
+TEST(testlinkedlist, testUnrolledMatchesVector) {
+    UnrolledLinkedList<int> numbers;
+    checkAgainstVector<UnrolledLinkedList<int>, int>(&numbers,
+        [](int i) { return i; }, 5000);
+    EXPECT_FALSE(numbers.contains(-1));
+
+    UnrolledLinkedList<std::string> words;
+    checkAgainstVector<UnrolledLinkedList<std::string>, std::string>(&words,
+        [](int i) { return "word" + std::to_string(i); }, 3000);
+
+    // copies are deep
+    UnrolledLinkedList<std::string> copy(words);
+    ASSERT_EQ(words.getLength(), copy.getLength());
+    copy.removeFirst();
+    EXPECT_EQ(words.getLength() - 1, copy.getLength());
+    copy = words;
+    for (int i = 0; i < words.getLength(); i++)
+        ASSERT_EQ(words.getItemAt(i), copy.getItemAt(i));
+}
+
+TEST(testlinkedlist, testUnrolledNodesStayFull) {
+    UnrolledLinkedList<int> list;
+    const int capacity = UnrolledListNode<int>::kCapacity;
+    for (int i = 0; i < 10 * capacity; i++) list.insertEnd(i);
+    EXPECT_EQ(10, list.getNodeCount());
+    for (int i = 0; i < 10 * capacity; i++) list.insertStart(i);
+    EXPECT_EQ(20, list.getNodeCount());
+
+    // removing from the front empties and frees whole nodes
+    for (int i = 0; i < 10 * capacity; i++) list.removeFirst();
+    EXPECT_EQ(10, list.getNodeCount());
+    while (list.getLength() > 0) list.removeLast();
+    EXPECT_EQ(0, list.getNodeCount());
+    EXPECT_EQ(0, list.removeFirst());
+}
+
+TEST(testlinkedlist, testLinkedListMatchesVector) {
+    LinkedList<int> numbers;
+    checkAgainstVector<LinkedList<int>, int>(&numbers, [](int i) { return i; }, 2000);
+}
+
+TEST(testlinkedlist, testPositionalAccessOnLongList) {
+    LinkedList<int> list;
+    std::vector<int> expected;
+    for (int i = 0; i < 3000; i++) {
+        list.insertEnd(i);
+        expected.push_back(i);
+    }
+    // positional inserts and removes keep the checkpoints in step, the
+    // other changes drop them
+    std::srand(11);
+    for (int i = 0; i < 4000; i++) {
+        int length = expected.size();
+        int index = std::rand() % length;
+        switch (std::rand() % 8) {
+            case 0: case 1:
+                list.insertAt(-i, index);
+                expected.insert(expected.begin() + index, -i);
+                break;
+            case 2: case 3:
+                ASSERT_EQ(expected[index], list.removeAt(index));
+                expected.erase(expected.begin() + index);
+                break;
+            case 4:
+                ASSERT_EQ(expected.back(), list.removeLast());
+                expected.pop_back();
+                list.insertEnd(i);
+                expected.push_back(i);
+                break;
+            case 5:
+                list.erase(--list.end());
+                expected.pop_back();
+                list.emplaceEnd(i);
+                expected.push_back(i);
+                break;
+            case 6:
+                if (i % 16 == 0) {
+                    list.insertStart(i);
+                    expected.insert(expected.begin(), i);
+                }
+                break;
+            default:
+                break;
+        }
+        index = std::rand() % (int)expected.size();
+        ASSERT_EQ(expected[index], list.getItemAt(index));
+        ASSERT_EQ((int)expected.size(), list.getLength());
+    }
+    for (int i = 0; i < (int)expected.size(); i++)
+        ASSERT_EQ(expected[i], list.getItemAt(i));
+
+    // shrinking the list a lot picks a smaller stride
+    while (list.getLength() > 40) list.removeAt(list.getLength() / 2);
+    std::vector<int> rest(list.begin(), list.end());
+    for (int i = 0; i < (int)rest.size(); i++) ASSERT_EQ(rest[i], list.getItemAt(i));
+}
+
+// std::allocator tagged with an arena, allocators of different arenas
+// compare unequal so lists using them can't trade nodes
+template<class T>
+struct ArenaAllocator {
+    typedef T value_type;
+    explicit ArenaAllocator(int a = 0) : arena(a) {}
+    template<class U> ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+    T* allocate(std::size_t count) { return std::allocator<T>().allocate(count); }
+    void deallocate(T* pointer, std::size_t count) { std::allocator<T>().deallocate(pointer, count); }
+    template<class U> bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template<class U> bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+    int arena;
+};
+
+TEST(testlinkedlist, testHashedMembership) {
+    // a deduplicating queue
+    HashedLinkedList<std::string> queue;
+    LinkedList<std::string> scanned;
+    std::srand(5);
+    for (int i = 0; i < 5000; i++) {
+        std::string word = "word" + std::to_string(std::rand() % 300);
+        ASSERT_EQ(scanned.contains(word), queue.contains(word));
+        switch (std::rand() % 4) {
+            case 0: case 1:
+                if (!queue.contains(word)) {
+                    queue.insertEnd(word);
+                    scanned.insertEnd(word);
+                }
+                break;
+            case 2:
+                ASSERT_EQ(scanned.removeFirst(), queue.removeFirst());
+                break;
+            case 3:
+                ASSERT_EQ(scanned.remove(word), queue.remove(word));
+                ASSERT_FALSE(queue.contains(word));
+                break;
+        }
+        ASSERT_EQ(scanned.getLength(), queue.getLength());
+    }
+
+    // nodes moving between lists move between indexes
+    HashedLinkedList<int> first, second;
+    for (int i = 0; i < 100; i++) first.insertEnd(i);
+    second.insertEnd(-1);
+    second.splice(second.begin(), first);
+    EXPECT_FALSE(first.contains(5));
+    EXPECT_TRUE(second.contains(5));
+    first.splice(first.end(), second, second.begin());
+    EXPECT_TRUE(first.contains(0));
+    EXPECT_FALSE(second.contains(0));
+    HashedLinkedList<int> moved(std::move(second));
+    EXPECT_TRUE(moved.contains(-1));
+    EXPECT_FALSE(second.contains(-1));
+
+    // move assignment takes the nodes, or moves the values across when the
+    // allocators differ, and the index follows either way
+    HashedLinkedList<int> assigned;
+    assigned.insertEnd(500);
+    int moved_length = moved.getLength();
+    assigned = std::move(moved);
+    EXPECT_TRUE(assigned.contains(-1));
+    EXPECT_FALSE(assigned.contains(500));
+    EXPECT_FALSE(moved.contains(-1));
+    moved = std::move(assigned);
+    EXPECT_EQ(moved_length, moved.getLength());
+    EXPECT_TRUE(moved.contains(-1));
+
+    typedef LinkedList<std::string, ArenaAllocator<std::string>,
+                       HashedMembership<std::string>> ArenaList;
+    ArenaList first_arena(ArenaAllocator<std::string>(1));
+    ArenaList second_arena(ArenaAllocator<std::string>(2));
+    for (int i = 0; i < 20; i++) first_arena.insertEnd("word" + std::to_string(i));
+    second_arena.insertEnd("gone");
+    second_arena = std::move(first_arena);
+    EXPECT_EQ(0, first_arena.getLength());
+    EXPECT_FALSE(first_arena.contains("word3"));
+    EXPECT_EQ(20, second_arena.getLength());
+    EXPECT_TRUE(second_arena.contains("word3"));
+    EXPECT_FALSE(second_arena.contains("gone"));
+    EXPECT_TRUE(second_arena.remove("word19"));
+    EXPECT_EQ("word18", second_arena.getLast());
+
+    // duplicates are removed one at a time
+    moved.insertStart(7);
+    EXPECT_TRUE(moved.remove(7));
+    EXPECT_TRUE(moved.contains(7));
+    EXPECT_TRUE(moved.remove(7));
+    EXPECT_FALSE(moved.contains(7));
+    EXPECT_FALSE(moved.remove(7));
+    moved.clear();
+    EXPECT_FALSE(moved.contains(50));
+}
+
+TEST(testlinkedlist, testHashedMembershipConstElements) {
+    // elements of an indexed list can't be written in place
+    typedef HashedLinkedList<std::string> List;
+    static_assert(std::is_same<List::iterator, List::const_iterator>::value,
+                  "indexed lists only have const iterators");
+    static_assert(std::is_same<List::reference, const std::string&>::value,
+                  "indexed lists only hand out const references");
+    static_assert(std::is_same<LinkedList<std::string>::reference, std::string&>::value,
+                  "plain lists hand out mutable references");
+
+    // the index follows every way of adding, moving and removing elements
+    List list;
+    EXPECT_EQ("b", list.emplaceEnd("b"));
+    EXPECT_EQ("a", list.emplaceStart("a"));
+    List::iterator position = list.emplace(list.end(), 3, 'c');
+    list.insert(position, "d");
+    list.insert(list.begin(), std::string("e"));
+    list.sort();
+    EXPECT_EQ((std::vector<std::string>{"a", "b", "ccc", "d", "e"}),
+              (std::vector<std::string>(list.begin(), list.end())));
+    for (const char* value : {"a", "b", "ccc", "d", "e"}) {
+        EXPECT_TRUE(list.contains(value));
+    }
+    position = list.erase(++list.begin());
+    EXPECT_EQ("ccc", *position);
+    EXPECT_FALSE(list.contains("b"));
+    list.erase(position);
+    EXPECT_FALSE(list.contains("ccc"));
+    EXPECT_EQ("e", list.removeLast());
+    EXPECT_FALSE(list.contains("e"));
+    list.insertEnd("e");
+    EXPECT_EQ("a", list.removeAt(0));
+    EXPECT_TRUE(list.remove("e"));
+    EXPECT_FALSE(list.remove("e"));
+    EXPECT_TRUE(list.contains("d"));
+    EXPECT_EQ(1, list.getLength());
+}
+
+TEST(testlinkedlist, testIteratorsInsertErase) {
+    LinkedList<std::string> list;
+    for (int i = 0; i < 5; i++) list.insertEnd(std::to_string(i));
+
+    std::vector<std::string> seen(list.begin(), list.end());
+    EXPECT_EQ((std::vector<std::string>{"0", "1", "2", "3", "4"}), seen);
+    LinkedList<std::string>::const_iterator last = --list.cend();
+    EXPECT_EQ("4", *last);
+
+    // insert before the third element, erase the second
+    LinkedList<std::string>::iterator position = list.begin();
+    ++position;
+    ++position;
+    LinkedList<std::string>::iterator inserted = list.emplace(position, 3, 'x');
+    EXPECT_EQ("xxx", *inserted);
+    list.insert(list.end(), "5");
+    position = list.erase(--inserted);
+    EXPECT_EQ("xxx", *position);
+    seen.assign(list.begin(), list.end());
+    EXPECT_EQ((std::vector<std::string>{"0", "xxx", "2", "3", "4", "5"}), seen);
+    EXPECT_EQ(6, list.getLength());
+    EXPECT_EQ("xxx", list.getItemAt(1));
+
+    // erasing while iterating
+    for (auto it = list.begin(); it != list.end();) {
+        if (it->size() > 1) it = list.erase(it);
+        else ++it;
+    }
+    EXPECT_EQ(5, list.getLength());
+    EXPECT_EQ("2", list.getItemAt(1));
+}
+
+TEST(testlinkedlist, testSpliceAndSort) {
+    LinkedList<int> first, second;
+    for (int i = 0; i < 4; i++) {
+        first.insertEnd(i);
+        second.insertEnd(10 + i);
+    }
+    first.splice(++first.begin(), second);
+    EXPECT_EQ(8, first.getLength());
+    EXPECT_EQ(0, second.getLength());
+    EXPECT_EQ(second.begin(), second.end());
+    std::vector<int> seen(first.begin(), first.end());
+    EXPECT_EQ((std::vector<int>{0, 10, 11, 12, 13, 1, 2, 3}), seen);
+
+    // single elements move between lists and within one
+    second.splice(second.end(), first, first.begin());
+    first.splice(first.end(), first, first.begin());
+    EXPECT_EQ(7, first.getLength());
+    EXPECT_EQ(1, second.getLength());
+    EXPECT_EQ(0, second.getFirst());
+    EXPECT_EQ(10, first.getLast());
+    EXPECT_EQ(11, first.getFirst());
+
+    // sorting is stable and keeps prev links consistent
+    LinkedList<std::pair<int, int>> pairs;
+    std::srand(3);
+    for (int i = 0; i < 1000; i++) pairs.insertEnd(std::make_pair(std::rand() % 50, i));
+    pairs.sort([](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+        return a.first < b.first;
+    });
+    EXPECT_EQ(1000, pairs.getLength());
+    std::vector<std::pair<int, int>> sorted(pairs.begin(), pairs.end());
+    for (std::size_t i = 1; i < sorted.size(); i++) {
+        ASSERT_LE(sorted[i - 1].first, sorted[i].first);
+        if (sorted[i - 1].first == sorted[i].first) {
+            ASSERT_LT(sorted[i - 1].second, sorted[i].second);
+        }
+    }
+    std::vector<std::pair<int, int>> backwards;
+    for (auto it = pairs.end(); it != pairs.begin();) backwards.push_back(*--it);
+    std::vector<std::pair<int, int>> forwards(backwards.rbegin(), backwards.rend());
+    EXPECT_EQ(sorted, forwards);
+
+    // copies are deep
+    LinkedList<int> copy(first);
+    copy.sort(std::greater<int>());
+    EXPECT_EQ(13, copy.getFirst());
+    EXPECT_EQ(11, first.getFirst());
+    copy = second;
+    EXPECT_EQ(1, copy.getLength());
+}
+
+// counts copies and moves of the payload
+struct CountedValue {
+    static int copies;
+    static int moves;
+    int value;
+    CountedValue(int v = 0) : value(v) {}
+    CountedValue(const CountedValue& other) : value(other.value) { copies++; }
+    CountedValue(CountedValue&& other) : value(other.value) { moves++; }
+    CountedValue& operator=(const CountedValue& other) { value = other.value; copies++; return *this; }
+    CountedValue& operator=(CountedValue&& other) { value = other.value; moves++; return *this; }
+    bool operator==(const CountedValue& other) const { return value == other.value; }
+};
+int CountedValue::copies = 0;
+int CountedValue::moves = 0;
+
+// std::allocator that counts the nodes it hands out, for every T
+static int counting_allocations = 0;
+
+template<class T>
+struct CountingAllocator {
+    typedef T value_type;
+    CountingAllocator() {}
+    template<class U> CountingAllocator(const CountingAllocator<U>&) {}
+    T* allocate(std::size_t count) { counting_allocations++; return std::allocator<T>().allocate(count); }
+    void deallocate(T* pointer, std::size_t count) { std::allocator<T>().deallocate(pointer, count); }
+    template<class U> bool operator==(const CountingAllocator<U>&) const { return true; }
+    template<class U> bool operator!=(const CountingAllocator<U>&) const { return false; }
+};
+
+TEST(testlinkedlist, testMovesAndPooledNodes) {
+    LinkedList<CountedValue> values;
+    CountedValue::copies = CountedValue::moves = 0;
+    values.insertEnd(CountedValue(1));
+    values.insertStart(CountedValue(0));
+    values.emplaceEnd(2);
+    values.insertAt(CountedValue(3), 1);
+    EXPECT_EQ(0, CountedValue::copies);
+    EXPECT_EQ(0, values.removeFirst().value);
+    EXPECT_EQ(2, values.removeLast().value);
+    EXPECT_EQ(3, values.removeAt(0).value);
+    EXPECT_EQ(0, CountedValue::copies);
+    EXPECT_EQ(1, values.getLength());
+
+    // moving a list moves its nodes, not its elements
+    CountedValue::moves = 0;
+    LinkedList<CountedValue> moved(std::move(values));
+    EXPECT_EQ(0, values.getLength());
+    EXPECT_EQ(1, moved.getLength());
+    values = std::move(moved);
+    EXPECT_EQ(1, values.getFirst().value);
+    EXPECT_EQ(0, CountedValue::moves + CountedValue::copies);
+
+    // a queue reuses its nodes once it has reached its largest size
+    typedef CountingAllocator<std::string> Allocator;
+    LinkedList<std::string, Allocator> queue;
+    for (int i = 0; i < 100; i++) queue.insertEnd(std::to_string(i));
+    int allocations = counting_allocations;
+    for (int round = 0; round < 50; round++) {
+        for (int i = 0; i < 100; i++) queue.removeFirst();
+        for (int i = 0; i < 100; i++) queue.emplaceEnd(std::to_string(i));
+    }
+    EXPECT_EQ(allocations, counting_allocations);
+    queue.reserve(150);
+    allocations = counting_allocations;
+    for (int i = 0; i < 50; i++) queue.insertStart("x");
+    EXPECT_EQ(allocations, counting_allocations);
+    EXPECT_EQ(150, queue.getLength());
+    queue.clear();
+    queue.releaseFreeNodes();
+    queue.insertEnd("y");
+    EXPECT_EQ(allocations + 1, counting_allocations);
+}
+
+TEST(testlinkedlist, testConcurrentQueue) {
+    ConcurrentQueue<std::string> words;
+    std::string word = "unchanged";
+    EXPECT_TRUE(words.isEmpty());
+    EXPECT_FALSE(words.removeFirst(&word));
+    EXPECT_EQ("unchanged", word);
+    words.insertEnd("one");
+    words.emplaceEnd(3, 'x');
+    words.insertEnd(std::string("three"));
+    ASSERT_TRUE(words.removeFirst(&word));
+    EXPECT_EQ("one", word);
+    ASSERT_TRUE(words.removeFirst(&word));
+    EXPECT_EQ("xxx", word);
+    EXPECT_FALSE(words.isEmpty());
+    // "three" is left for the destructor
+
+    // every producer's values come out in the order it put them in, and
+    // each exactly once
+    const int kProducers = 4, kConsumers = 4, kCount = 20000;
+    ConcurrentQueue<int> queue;
+    std::vector<std::vector<int>> taken(kConsumers);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < kProducers; p++) {
+        threads.emplace_back([&queue, p]() {
+            for (int i = 0; i < kCount; i++) queue.insertEnd(p * kCount + i);
+        });
+    }
+    std::atomic<int> consumed(0);
+    for (int c = 0; c < kConsumers; c++) {
+        threads.emplace_back([&queue, &taken, &consumed, c]() {
+            int value;
+            while (consumed.load() < kProducers * kCount) {
+                if (queue.removeFirst(&value)) {
+                    taken[c].push_back(value);
+                    consumed.fetch_add(1);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    std::vector<int> seen(kProducers * kCount, 0);
+    for (const std::vector<int>& values : taken) {
+        std::vector<int> last(kProducers, -1);
+        for (int value : values) {
+            ASSERT_LT(last[value / kCount], value);
+            last[value / kCount] = value;
+            seen[value]++;
+        }
+    }
+    for (int count : seen) ASSERT_EQ(1, count);
+    EXPECT_TRUE(queue.isEmpty());
+}
+
+// an element on two lists at once
+struct ByAge {};
+struct ByUse {};
+struct Connection : IntrusiveListHook<ByAge>, IntrusiveListHook<ByUse> {
+    int id;
+    explicit Connection(int i) : id(i) {}
+};
+
+typedef IntrusiveList<Connection, ByAge> ConnectionsByAge;
+typedef IntrusiveList<Connection, ByUse> ConnectionsByUse;
+
+template<class List>
+static std::vector<int> connectionIds(const List& list) {
+    std::vector<int> ids;
+    for (const Connection& connection : list) ids.push_back(connection.id);
+    return ids;
+}
+
+TEST(testlinkedlist, testIntrusiveList) {
+    std::vector<std::unique_ptr<Connection>> connections;
+    ConnectionsByAge by_age;
+    ConnectionsByUse by_use;
+    for (int i = 0; i < 5; i++) {
+        connections.emplace_back(new Connection(i));
+        by_age.insertEnd(*connections.back());
+        by_use.insertStart(*connections.back());
+    }
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4}), connectionIds(by_age));
+    EXPECT_EQ((std::vector<int>{4, 3, 2, 1, 0}), connectionIds(by_use));
+
+    // using a connection moves it to the end of one list only
+    Connection& used = *connections[1];
+    by_use.splice(by_use.end(), by_use, used);
+    EXPECT_EQ((std::vector<int>{4, 3, 2, 0, 1}), connectionIds(by_use));
+    EXPECT_EQ(&used, by_use.getLast());
+    EXPECT_EQ(connections[0].get(), by_age.getFirst());
+
+    // removal by reference leaves the other list alone
+    by_age.remove(*connections[2]);
+    EXPECT_FALSE(connections[2]->IntrusiveListHook<ByAge>::isLinked());
+    EXPECT_TRUE(connections[2]->IntrusiveListHook<ByUse>::isLinked());
+    EXPECT_EQ((std::vector<int>{0, 1, 3, 4}), connectionIds(by_age));
+    EXPECT_EQ(4, by_age.getLength());
+    EXPECT_EQ(5, by_use.getLength());
+
+    // elements come back as themselves, not copies
+    EXPECT_EQ(connections[4].get(), by_use.removeFirst());
+    EXPECT_EQ(connections[4].get(), by_age.removeLast());
+    auto position = by_age.erase(by_age.iteratorTo(*connections[1]));
+    EXPECT_EQ(3, position->id);
+    by_age.insert(position, *connections[2]);
+    EXPECT_EQ((std::vector<int>{0, 2, 3}), connectionIds(by_age));
+
+    ConnectionsByAge moved(std::move(by_age));
+    EXPECT_EQ(0, by_age.getLength());
+    EXPECT_EQ(nullptr, by_age.removeFirst());
+    EXPECT_EQ((std::vector<int>{0, 2, 3}), connectionIds(moved));
+    moved.clear();
+    EXPECT_FALSE(connections[0]->IntrusiveListHook<ByAge>::isLinked());
+    by_use.clear();
+}
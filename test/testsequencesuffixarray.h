@@ -0,0 +1,91 @@
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "../include/sequencesuffixarray.h"
+#include "../include/stringsequencetrie.h"
+
+using namespace testing;
+
+static std::vector<std::string> suffixArrayTestText() {
+    std::vector<std::string> words;
+    const char* text[] = {"the", "cat", "sat", "on", "the", "mat", "and", "the",
+        "cat", "ran", "to", "the", "dog", "on", "the", "mat", "the", "cat", "sat"};
+    for (int i = 0; i < 3; i++)
+        words.insert(words.end(), std::begin(text), std::end(text));
+    return words;
+}
+
+TEST(testsequencesuffixarray, testCountsMatchTrie) {
+    std::vector<std::string> words = suffixArrayTestText();
+    SequenceSuffixArray suffix_array;
+    suffix_array.addSequence(words);
+    StringSequenceTrie trie;
+    trie.addSequence(words, 4);
+
+    EXPECT_EQ(words.size(), suffix_array.getNumberWords());
+    EXPECT_EQ(trie.getNumberUniqueWords(), suffix_array.getNumberUniqueWords());
+
+    // every sequence of up to the trie's window is counted the same
+    for (std::size_t start = 0; start < words.size(); start++) {
+        std::string sequence;
+        for (std::size_t length = 1; length <= 4 && start + length <= words.size(); length++) {
+            sequence += (length > 1 ? " " : "") + words[start + length - 1];
+            ASSERT_NE(nullptr, trie.getNode(sequence));
+            EXPECT_EQ((std::size_t)trie.getNode(sequence)->getTimesSeen(),
+                      suffix_array.getCount(sequence)) << sequence;
+        }
+    }
+    EXPECT_EQ(0u, suffix_array.getCount("the zebra"));
+    EXPECT_EQ(0u, suffix_array.getCount("mat the mat"));
+
+    // no window, the whole text is one sequence
+    std::string text;
+    for (const std::string &word : words) text += word + " ";
+    EXPECT_EQ(1u, suffix_array.getCount(text));
+    EXPECT_EQ(3u, suffix_array.getCount("to the dog on the mat the cat sat"));
+
+    StringSequenceTrie::SequenceCriteria criteria;
+    criteria.m_length_max_count = 4;
+    criteria.m_length_min_count = 1;
+    criteria.m_frequency_min = 2;
+    std::vector<StringSequenceTrieNode*> expected = trie.getOrderedWords(criteria, 10);
+    std::vector<std::pair<std::string, int>> actual = suffix_array.getOrderedWords(criteria, 10);
+    ASSERT_EQ(expected.size(), actual.size());
+    for (std::size_t i = 0; i < expected.size(); i++) {
+        EXPECT_EQ(expected[i]->getTimesSeen(), actual[i].second);
+        EXPECT_EQ(actual[i].second, (int)suffix_array.getCount(actual[i].first));
+    }
+}
+
+TEST(testsequencesuffixarray, testPredictNextWords) {
+    SequenceSuffixArray suffix_array;
+    suffix_array.addSequence(suffixArrayTestText());
+    // a second document, sequences don't run from one into the other
+    const std::string_view document[] = {"sat", "by", "the", "fire"};
+    suffix_array.addSequence(document, 4);
+
+    EXPECT_EQ("cat", suffix_array.getNextWord("the"));
+    EXPECT_EQ("sat", suffix_array.getNextWord("the cat"));
+    EXPECT_EQ("fire", suffix_array.getNextWord("sat by the"));
+    EXPECT_EQ(0u, suffix_array.getCount("cat sat sat by"));
+
+    // a context longer than any window is still matched in full
+    std::vector<WordId> context = suffix_array.getWordIds(
+        "and the cat ran to the dog on the mat the cat");
+    std::vector<WordId> next_words;
+    EXPECT_EQ(12, suffix_array.predictNextWords(context.data(), context.size(),
+                                                &next_words, 4));
+    ASSERT_EQ(1u, next_words.size());
+    EXPECT_EQ("sat", suffix_array.getWord(next_words[0]));
+
+    // "zebra" was never seen, backs off to "the"
+    context = suffix_array.getWordIds("zebra the");
+    EXPECT_EQ(1, suffix_array.predictNextWords(context.data(), context.size(),
+                                               &next_words, 2));
+    ASSERT_EQ(2u, next_words.size());
+    EXPECT_EQ("cat", suffix_array.getWord(next_words[0]));
+    EXPECT_EQ("mat", suffix_array.getWord(next_words[1]));
+}
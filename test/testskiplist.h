@@ -0,0 +1,175 @@
+#include <cstdlib>
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "../include/concurrentskiplist.h"
+#include "../include/skiplist.h"
+
+using namespace testing;
+
+// runs the same random inserts and removes on list and a multiset
+template<class List>
+static void checkAgainstMultiset(List* list, int operations) {
+    std::multiset<int> expected;
+    std::srand(13);
+    for (int i = 0; i < operations; i++) {
+        int value = std::rand() % 500;
+        if (std::rand() % 3 != 0) {
+            list->insert(value);
+            expected.insert(value);
+        } else {
+            list->remove(value);
+            if (expected.count(value) != 0) expected.erase(expected.find(value));
+        }
+        ASSERT_EQ(expected.count(value) != 0, list->contains(value));
+        ASSERT_EQ((int)expected.size(), list->getLength());
+    }
+    for (int value = -1; value <= 500; value++)
+        ASSERT_EQ(expected.count(value) != 0, list->contains(value));
+    ASSERT_FALSE(expected.empty());
+    EXPECT_EQ(*expected.begin(), list->getFirst());
+    EXPECT_EQ(*expected.rbegin(), list->getLast());
+}
+
+TEST(testskiplist, testMatchesMultiset) {
+    SkipList<int> list;
+    checkAgainstMultiset(&list, 20000);
+    SkipList<int, std::less<int>, false> without_back_links;
+    checkAgainstMultiset(&without_back_links, 20000);
+
+    // copies are deep and keep the order
+    SkipList<int> copy(list);
+    EXPECT_EQ(list.getLength(), copy.getLength());
+    EXPECT_EQ(list.getFirst(), copy.getFirst());
+    EXPECT_EQ(list.getLast(), copy.getLast());
+    copy.remove(list.getFirst());
+    EXPECT_EQ(list.getLength() - 1, copy.getLength());
+    copy.clear();
+    EXPECT_TRUE(copy.isEmpty());
+    EXPECT_FALSE(copy.contains(list.getFirst()));
+    copy = list;
+    for (int value = 0; value < 500; value++)
+        ASSERT_EQ(list.contains(value), copy.contains(value));
+}
+
+// checks bounds, scans and iteration of list, holding numbers below 500,
+// against expected
+template<class List>
+static void checkOrderedAccess(const List& list, const std::multiset<int>& expected) {
+    std::vector<int> forwards(list.begin(), list.end());
+    EXPECT_EQ(std::vector<int>(expected.begin(), expected.end()), forwards);
+    std::vector<int> backwards(list.rbegin(), list.rend());
+    EXPECT_EQ(std::vector<int>(expected.rbegin(), expected.rend()), backwards);
+
+    for (int value = -1; value <= 500; value++) {
+        auto lower = list.lower_bound(value);
+        auto expected_lower = expected.lower_bound(value);
+        if (expected_lower == expected.end()) ASSERT_EQ(list.end(), lower);
+        else ASSERT_EQ(*expected_lower, *lower);
+        auto upper = list.upper_bound(value);
+        auto expected_upper = expected.upper_bound(value);
+        if (expected_upper == expected.end()) ASSERT_EQ(list.end(), upper);
+        else ASSERT_EQ(*expected_upper, *upper);
+        // equal values sit between the bounds
+        ASSERT_EQ((int)expected.count(value), (int)std::distance(lower, upper));
+    }
+
+    std::vector<int> scanned;
+    int count = list.rangeScan(100, 200, [&scanned](int value) { scanned.push_back(value); });
+    std::vector<int> in_range(expected.lower_bound(100), expected.lower_bound(200));
+    EXPECT_EQ(in_range, scanned);
+    EXPECT_EQ((int)in_range.size(), count);
+    EXPECT_EQ(0, list.rangeScan(200, 100, [](int) {}));
+}
+
+TEST(testskiplist, testOrderedAccess) {
+    SkipList<int> list;
+    SkipList<int, std::less<int>, false> without_back_links;
+    std::multiset<int> expected;
+    std::srand(17);
+    for (int i = 0; i < 3000; i++) {
+        int value = std::rand() % 500;
+        list.insert(value);
+        without_back_links.insert(value);
+        expected.insert(value);
+    }
+    checkOrderedAccess(list, expected);
+    checkOrderedAccess(without_back_links, expected);
+
+    SkipList<int>::const_iterator last = --list.end();
+    EXPECT_EQ(*expected.rbegin(), *last);
+    EXPECT_EQ(*expected.rbegin(), *--without_back_links.end());
+
+    SkipList<int> empty;
+    EXPECT_EQ(empty.begin(), empty.end());
+    EXPECT_EQ(empty.end(), empty.lower_bound(3));
+    EXPECT_EQ(0, empty.rangeScan(0, 10, [](int) {}));
+}
+
+TEST(testskiplist, testLevelsFollowLength) {
+    SkipList<std::string, std::greater<std::string>> words;
+    for (int i = 0; i < 1000; i++) words.insert("word" + std::to_string(i));
+    EXPECT_EQ("word999", words.getFirst());
+    EXPECT_EQ("word0", words.getLast());
+    // 1000 elements cap levels at 11, the first few inserts at 2 or 3
+    EXPECT_LE(words.getLevel(), 11);
+    EXPECT_GE(words.getLevel(), 5);
+    for (int i = 0; i < 1000; i++) words.remove("word" + std::to_string(i));
+    EXPECT_TRUE(words.isEmpty());
+    EXPECT_EQ(1, words.getLevel());
+}
+
+TEST(testskiplist, testConcurrentSkipList) {
+    ConcurrentSkipList<int> set;
+    EXPECT_TRUE(set.insert(5));
+    EXPECT_FALSE(set.insert(5));
+    EXPECT_TRUE(set.contains(5));
+    EXPECT_TRUE(set.remove(5));
+    EXPECT_FALSE(set.remove(5));
+    EXPECT_TRUE(set.isEmpty());
+
+    // threads fight over a few keys. each counts its successful inserts
+    // minus removes per key, which must add up to whether the key is left
+    const int kThreads = 8, kKeys = 64, kOperations = 20000;
+    std::vector<std::vector<int>> balance(kThreads, std::vector<int>(kKeys, 0));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([&set, &balance, t]() {
+            std::minstd_rand generator(t + 1);
+            for (int i = 0; i < kOperations; i++) {
+                int key = generator() % kKeys;
+                switch (generator() % 3) {
+                    case 0: balance[t][key] += set.insert(key); break;
+                    case 1: balance[t][key] -= set.remove(key); break;
+                    default: set.contains(key); break;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    int length = 0;
+    for (int key = 0; key < kKeys; key++) {
+        int total = 0;
+        for (int t = 0; t < kThreads; t++) total += balance[t][key];
+        ASSERT_EQ(total, set.contains(key) ? 1 : 0);
+        length += total;
+    }
+    EXPECT_EQ(length, set.getLength());
+
+    // disjoint inserts all land
+    ConcurrentSkipList<std::string> words;
+    threads.clear();
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([&words, t]() {
+            for (int i = t; i < 4000; i += kThreads) words.insert("word" + std::to_string(i));
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    EXPECT_EQ(4000, words.getLength());
+    for (int i = 0; i < 4000; i++) ASSERT_TRUE(words.contains("word" + std::to_string(i)));
+}
@@ -0,0 +1,717 @@
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock-matchers.h>
+#include "allocationcounter.h"
+#include "../include/concurrentsequencetrie.h"
+#include "../include/corpusreader.h"
+#include "../include/sequencegenerator.h"
+#include "../include/sequencelanguagemodel.h"
+#include "../include/stringsequencetrie.h"
+
+using namespace testing;
+
+TEST(teststringsequencetrie, testChildrenSortedAndHashed) {
+    SequenceChildren children;
+    std::vector<std::unique_ptr<StringSequenceTrieNode>> nodes;
+    for (WordId id = 0; id <= 100; id++)
+        nodes.emplace_back(new StringSequenceTrieNode(id, nullptr));
+    auto fake_node = [&nodes](WordId id) { return nodes[id].get(); };
+
+    // insert enough ids to move from the sorted array to the hash table
+    for (WordId id = 100; id > 0; id -= 5) {
+        EXPECT_EQ(nullptr, children.findOrInsert(id));
+        children.findOrInsert(id) = fake_node(id);
+    }
+    EXPECT_EQ(20u, children.size());
+    for (WordId id = 100; id > 0; id -= 5)
+        EXPECT_EQ(fake_node(id), children.find(id));
+    EXPECT_EQ(nullptr, children.find(3));
+
+    // erase back down into the sorted layout
+    for (WordId id = 100; id > 10; id -= 5)
+        EXPECT_TRUE(children.erase(id));
+    EXPECT_FALSE(children.erase(100));
+    EXPECT_EQ(2u, children.size());
+    EXPECT_EQ(fake_node(5), children.find(5));
+    EXPECT_EQ(fake_node(10), children.find(10));
+
+    int iterated = 0;
+    for (const auto &child : children) {
+        EXPECT_EQ(fake_node(child.first), child.second);
+        iterated++;
+    }
+    EXPECT_EQ(2, iterated);
+}
+
+TEST(teststringsequencetrie, testSequenceCounts) {
+    StringSequenceTrie trie;
+    trie.addSequence("the cat sat");
+    trie.addSequence("the cat ran");
+    trie.addSequence("the dog sat");
+
+    StringSequenceTrie::SequenceCriteria criteria;
+    criteria.m_length_min_count = 1;
+    criteria.m_frequency_min = 1;
+    std::vector<StringSequenceTrieNode*> sequences = trie.getOrderedWords(criteria);
+
+    ASSERT_FALSE(sequences.empty());
+    EXPECT_EQ("the ", trie.buildSequenceFromFinalNode(sequences[0]));
+    EXPECT_EQ(3, sequences[0]->getTimesSeen());
+    EXPECT_EQ("the cat ", trie.buildSequenceFromFinalNode(sequences[1]));
+    EXPECT_EQ(2, sequences[1]->getTimesSeen());
+}
+
+TEST(teststringsequencetrie, testStartingSequence) {
+    StringSequenceTrie trie;
+    trie.addSequence("the cat sat");
+    trie.addSequence("the cat ran");
+    trie.addSequence("the cat sat");
+
+    StringSequenceTrie::SequenceCriteria criteria;
+    criteria.m_frequency_min = 1;
+    criteria.setStartingSequence("the cat");
+    std::vector<StringSequenceTrieNode*> sequences = trie.getOrderedWords(criteria);
+
+    ASSERT_EQ(2u, sequences.size());
+    EXPECT_EQ("the cat sat ", trie.buildSequenceFromFinalNode(sequences[0]));
+    EXPECT_EQ(2, sequences[0]->getTimesSeen());
+    EXPECT_EQ("the cat ran ", trie.buildSequenceFromFinalNode(sequences[1]));
+}
+
+TEST(teststringsequencetrie, testSlidingWindow) {
+    StringSequenceTrie trie;
+    trie.addSequence(std::vector<std::string>{"a", "b", "a", "b", "c"}, 2);
+
+    StringSequenceTrie::SequenceCriteria criteria;
+    criteria.m_length_min_count = 1;
+    criteria.m_length_max_count = 3;
+    criteria.m_frequency_min = 1;
+    std::vector<StringSequenceTrieNode*> sequences = trie.getOrderedWords(criteria);
+
+    // every word starts one sequence, windows never exceed two words
+    std::map<std::string, int> counts;
+    for (const StringSequenceTrieNode* node : sequences)
+        counts[trie.buildSequenceFromFinalNode(node)] = node->getTimesSeen();
+    EXPECT_EQ(2, counts["a "]);
+    EXPECT_EQ(2, counts["b "]);
+    EXPECT_EQ(1, counts["c "]);
+    EXPECT_EQ(2, counts["a b "]);
+    EXPECT_EQ(1, counts["b a "]);
+    EXPECT_EQ(1, counts["b c "]);
+    EXPECT_EQ(6u, counts.size());
+}
+
+TEST(teststringsequencetrie, testTopChildren) {
+    StringSequenceTrieNode head(kNoWord, nullptr);
+    std::map<WordId, int> counts;
+
+    // uneven counts across enough words to use the hash table layout
+    for (int i = 0; i < 500; i++) {
+        WordId word = (i * 7) % 23 < 11 ? i % 5 : i % 20;
+        head.addChild(word);
+        counts[word]++;
+
+        StringSequenceTrieNode* top[SequenceChildren::kTopChildren];
+        int cached = head.getChildren().getTopChildren(top, SequenceChildren::kTopChildren);
+        for (int i = 0; i < cached; i++) {
+            EXPECT_EQ(counts[top[i]->getWordId()], top[i]->getTimesSeen());
+            if (i > 0) {
+                EXPECT_GE(top[i-1]->getTimesSeen(), top[i]->getTimesSeen());
+            }
+        }
+        EXPECT_EQ(std::min<int>(counts.size(), SequenceChildren::kTopChildren), cached);
+
+        // no uncached word may be seen more often than the last cached one
+        for (const auto &count : counts) {
+            bool is_cached = false;
+            for (int k = 0; k < cached; k++)
+                is_cached |= top[k]->getWordId() == count.first;
+            if (!is_cached) {
+                EXPECT_LE(count.second, top[cached-1]->getTimesSeen());
+            }
+        }
+    }
+}
+
+TEST(teststringsequencetrie, testPredictNextWords) {
+    StringSequenceTrie trie;
+    trie.addSequence(std::vector<std::string>{"the", "cat", "sat", "the", "cat",
+        "ran", "the", "cat", "sat", "a", "dog", "sat", "the"}, 3);
+
+    EXPECT_EQ("sat", trie.getNextWord("the cat"));
+    EXPECT_EQ("cat", trie.getNextWord("the"));
+
+    std::vector<WordId> next_words;
+    std::vector<WordId> context = trie.getWordIds("the cat");
+    EXPECT_EQ(2, trie.predictNextWords(context.data(), context.size(), &next_words));
+    ASSERT_EQ(2u, next_words.size());
+    EXPECT_EQ("sat", trie.getWord(next_words[0]));
+    EXPECT_EQ("ran", trie.getWord(next_words[1]));
+
+    // "a cat" was never seen, backs off to "cat"
+    context = trie.getWordIds("a cat");
+    EXPECT_EQ(1, trie.predictNextWords(context.data(), context.size(), &next_words, 1));
+    ASSERT_EQ(1u, next_words.size());
+    EXPECT_EQ("sat", trie.getWord(next_words[0]));
+
+    // unknown words back off to the most frequent first words
+    context = trie.getWordIds("zebra");
+    EXPECT_EQ(kNoWord, context[0]);
+    EXPECT_EQ(0, trie.predictNextWords(context.data(), context.size(), &next_words, 1));
+    EXPECT_EQ("the", trie.getWord(next_words[0]));
+}
+
+// checks that the Kneser-Ney distribution after each context sums to 1
+// over the vocabulary and the unseen word
+static void expectKneserNeySumsToOne(const StringSequenceTrie &trie,
+                                     const std::vector<const char*> &contexts) {
+    SequenceLanguageModel model(trie);
+    for (const char* context : contexts) {
+        std::vector<WordId> ids = trie.getWordIds(context);
+        double total = model.getProbability(ids.data(), ids.size(), kNoWord);
+        for (WordId word = 0; word < trie.getNumberUniqueWords(); word++)
+            total += model.getProbability(ids.data(), ids.size(), word);
+        EXPECT_NEAR(1.0, total, 1e-6) << "context: " << context;
+    }
+}
+
+TEST(teststringsequencetrie, testKneserNeySumsToOne) {
+    StringSequenceTrie trie;
+    trie.addSequence(std::vector<std::string>{"the", "cat", "sat", "on", "the",
+        "mat", "and", "the", "dog", "sat", "on", "the", "cat", "and", "the",
+        "cat", "ran"}, 3);
+    trie.updateContinuationCounts();
+    SequenceLanguageModel model(trie);
+    expectKneserNeySumsToOne(trie, {"", "the", "on the", "sat on", "zebra the", "ran"});
+
+    // words seen only at the start of the text or of a sentence have no
+    // word before them, so they get no continuation count
+    StringSequenceTrie sentences;
+    sentences.addText("A cat sat on the mat. The dog sat on the cat! Dogs "
+                      "chase the cat. The cat ran to a tree? Cats climb trees.", 3);
+    sentences.updateContinuationCounts();
+    expectKneserNeySumsToOne(sentences, {"", "the", "on the", "sat on", "a",
+                                         "cat", "zebra the", "trees"});
+
+    // seen continuations beat unseen ones
+    std::vector<WordId> context = trie.getWordIds("on the");
+    EXPECT_GT(model.getProbability(context.data(), 2, trie.getWordId("mat")),
+              model.getProbability(context.data(), 2, trie.getWordId("ran")));
+    EXPECT_GT(model.getLogProbability("the cat sat on the mat"),
+              model.getLogProbability("mat the on sat cat the"));
+}
+
+TEST(teststringsequencetrie, testStupidBackoff) {
+    StringSequenceTrie trie;
+    trie.addSequence(std::vector<std::string>{"a", "b", "a", "c", "a", "b"}, 2);
+    trie.updateContinuationCounts();
+    SequenceLanguageModel model(trie,
+        SequenceLanguageModel::Smoothing::kStupidBackoff, 0.75, 0.4);
+
+    // "a" is followed by b twice and c once
+    std::vector<WordId> context = trie.getWordIds("a");
+    EXPECT_DOUBLE_EQ(2.0 / 3, model.getProbability(context.data(), 1, trie.getWordId("b")));
+    // "a a" never seen, backs off to count(a) / 6 words
+    EXPECT_DOUBLE_EQ(0.4 * 3 / 6, model.getProbability(context.data(), 1, trie.getWordId("a")));
+
+    std::vector<std::vector<WordId>> sentences = {
+        trie.getWordIds("c b a"), trie.getWordIds("a b a"), trie.getWordIds("a c a")};
+    std::vector<double> scores;
+    std::vector<int> ranking;
+    model.rankSentences(sentences, &scores, &ranking);
+    ASSERT_EQ(3u, ranking.size());
+    EXPECT_EQ(1, ranking[0]);
+    EXPECT_EQ(0, ranking[2]);
+}
+
+TEST(teststringsequencetrie, testOrderedWordsLimit) {
+    StringSequenceTrie trie;
+    std::vector<std::string> words;
+    const char* text[] = {"the", "cat", "sat", "on", "the", "mat", "and", "the",
+        "cat", "ran", "to", "the", "dog", "on", "the", "mat"};
+    for (int i = 0; i < 4; i++)
+        words.insert(words.end(), std::begin(text), std::end(text));
+    words.push_back("the");
+    words.push_back("cat");
+    trie.addSequence(words, 4);
+
+    StringSequenceTrie::SequenceCriteria criteria;
+    criteria.m_length_min_count = 1;
+    criteria.m_frequency_min = 1;
+    std::vector<StringSequenceTrieNode*> all = trie.getOrderedWords(criteria);
+    ASSERT_GT(all.size(), 5u);
+    for (std::size_t i = 1; i < all.size(); i++)
+        EXPECT_GE(all[i - 1]->getTimesSeen(), all[i]->getTimesSeen());
+    EXPECT_EQ("the", trie.getWord(all[0]->getWordId()));
+
+    // the best limit sequences have the same counts as the unlimited prefix
+    for (int limit : {1, 3, 5}) {
+        std::vector<StringSequenceTrieNode*> best = trie.getOrderedWords(criteria, limit);
+        ASSERT_EQ((std::size_t)limit, best.size());
+        for (int i = 0; i < limit; i++)
+            EXPECT_EQ(all[i]->getTimesSeen(), best[i]->getTimesSeen());
+    }
+
+    // frequency bounds are applied while searching
+    criteria.m_frequency_min = 5;
+    criteria.m_frequency_max = 8;
+    for (StringSequenceTrieNode* node : trie.getOrderedWords(criteria, 3)) {
+        EXPECT_GE(node->getTimesSeen(), 5);
+        EXPECT_LE(node->getTimesSeen(), 8);
+    }
+}
+
+TEST(teststringsequencetrie, testBinaryFileRoundTrip) {
+    StringSequenceTrie trie;
+    std::vector<std::string> words;
+    const char* text[] = {"the", "cat", "sat", "on", "the", "mat", "and", "the",
+        "cat", "ran", "to", "the", "dog"};
+    for (int i = 0; i < 3; i++)
+        words.insert(words.end(), std::begin(text), std::end(text));
+    trie.addSequence(words, 4);
+    // enough distinct followers of "the" to put it in a hash table
+    for (int i = 0; i < 12; i++)
+        trie.addSequence("the word" + std::to_string(i));
+
+    const std::string filename = "teststringsequencetrie.bin";
+    ASSERT_TRUE(trie.writeToFile(filename));
+
+    StringSequenceTrie loaded;
+    ASSERT_TRUE(loaded.readFromFile(filename));
+    EXPECT_EQ(trie.getNumberNodes(), loaded.getNumberNodes());
+    EXPECT_EQ(trie.getNumberUniqueWords(), loaded.getNumberUniqueWords());
+
+    StringSequenceTrie::SequenceCriteria criteria;
+    criteria.m_length_max_count = 4;
+    criteria.m_length_min_count = 1;
+    criteria.m_frequency_min = 1;
+    std::vector<StringSequenceTrieNode*> expected = trie.getOrderedWords(criteria);
+    std::vector<StringSequenceTrieNode*> actual = loaded.getOrderedWords(criteria);
+    ASSERT_EQ(expected.size(), actual.size());
+    for (std::size_t i = 0; i < expected.size(); i++)
+        EXPECT_EQ(expected[i]->getTimesSeen(), actual[i]->getTimesSeen());
+
+    const char* sequences[] = {"the cat sat", "cat ran to the", "the word7"};
+    for (const char* sequence : sequences) {
+        std::vector<WordId> ids = loaded.getWordIds(sequence);
+        EXPECT_EQ(trie.getNextWord(sequence), loaded.getNextWord(sequence));
+        for (WordId id : ids) EXPECT_NE(kNoWord, id);
+    }
+
+    // loading the same file again doubles every count
+    ASSERT_TRUE(loaded.readFromFile(filename));
+    EXPECT_EQ(trie.getNumberNodes(), loaded.getNumberNodes());
+    EXPECT_EQ(2 * expected[0]->getTimesSeen(),
+              loaded.getOrderedWords(criteria, 1)[0]->getTimesSeen());
+
+    // truncated files are rejected without reading past the end
+    std::ifstream infile(filename, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(infile)),
+                         std::istreambuf_iterator<char>());
+    infile.close();
+    std::ofstream outfile(filename, std::ios::binary);
+    outfile.write(contents.data(), contents.size() / 2);
+    outfile.close();
+    StringSequenceTrie truncated;
+    EXPECT_FALSE(truncated.readFromFile(filename));
+    std::remove(filename.c_str());
+    EXPECT_FALSE(truncated.readFromFile(filename));
+}
+
+TEST(teststringsequencetrie, testPruneAndBudget) {
+    std::vector<std::string> words;
+    const char* text[] = {"the", "cat", "sat", "on", "the", "mat", "and", "the",
+        "cat", "ran", "to", "the", "dog"};
+    for (int i = 0; i < 4; i++)
+        words.insert(words.end(), std::begin(text), std::end(text));
+    // rare words that are each only seen once
+    for (int i = 0; i < 200; i++) {
+        words.push_back("rare" + std::to_string(i));
+        words.push_back("the");
+    }
+
+    StringSequenceTrie trie;
+    trie.addSequence(words, 4);
+    std::size_t nodes = trie.getNumberNodes();
+    std::size_t bytes = trie.memoryUsage();
+
+    StringSequenceTrie::SequenceCriteria criteria;
+    criteria.m_length_max_count = 4;
+    criteria.m_length_min_count = 1;
+    criteria.m_frequency_min = 2;
+    std::vector<StringSequenceTrieNode*> frequent = trie.getOrderedWords(criteria);
+
+    // everything seen twice or more survives with the same counts
+    std::size_t removed = trie.prune(2);
+    EXPECT_GT(removed, 0u);
+    EXPECT_EQ(nodes - removed, trie.getNumberNodes());
+    EXPECT_LT(trie.memoryUsage(), bytes);
+    criteria.m_frequency_min = 1;
+    std::vector<StringSequenceTrieNode*> kept = trie.getOrderedWords(criteria);
+    ASSERT_EQ(frequent.size(), kept.size());
+    for (std::size_t i = 0; i < kept.size(); i++)
+        EXPECT_EQ(frequent[i]->getTimesSeen(), kept[i]->getTimesSeen());
+    EXPECT_EQ("cat", trie.getNextWord("the"));
+    EXPECT_EQ(0u, trie.prune(2));
+
+    // compacting to half the memory raises the minimum count further
+    bytes = trie.memoryUsage();
+    int min_count = trie.compactToBudget(bytes / 2);
+    EXPECT_GT(min_count, 2);
+    EXPECT_LE(trie.memoryUsage(), bytes / 2);
+    for (StringSequenceTrieNode* node : trie.getOrderedWords(criteria))
+        EXPECT_GE(node->getTimesSeen(), min_count);
+    EXPECT_EQ(0, trie.compactToBudget(bytes));
+
+    // a budget keeps the tries under it while sequences are being added
+    StringSequenceTrie budgeted;
+    budgeted.setMemoryBudget(8 * 1024);
+    budgeted.addSequence(words, 4);
+    EXPECT_LE(budgeted.memoryUsage(), 8u * 1024);
+    EXPECT_EQ("cat", budgeted.getNextWord("the"));
+}
+
+TEST(teststringsequencetrie, testQueriesDontAllocate) {
+    StringSequenceTrie trie;
+    // words too long to fit in a string's inline buffer, so any temporary
+    // std::string made while splitting them would allocate
+    const std::string_view words[] = {"extraordinarily", "uncomfortable",
+        "conversations", "extraordinarily", "uncomfortable", "circumstances"};
+    trie.addSequence(words, 6, 3);
+    trie.addSequence("the cat sat");
+
+    AllocationCounter allocations;
+    const StringSequenceTrieNode* node = trie.getNode("extraordinarily  uncomfortable");
+    WordId next_word = trie.getNextWordId("very extraordinarily uncomfortable");
+    WordId unknown = trie.getNextWordId("uncomfortable zebra");
+    WordId word = trie.getWordId("circumstances");
+    std::string cat = trie.getNextWord("the");
+    // counting a sequence that is already in the tries
+    trie.addSequence("the cat sat");
+    EXPECT_EQ(0u, allocations.count());
+
+    ASSERT_NE(nullptr, node);
+    EXPECT_EQ(2, node->getTimesSeen());
+    EXPECT_EQ("conversations", trie.getWord(next_word));
+    EXPECT_NE(kNoWord, unknown);
+    EXPECT_EQ("circumstances", trie.getWord(word));
+    EXPECT_EQ("cat", cat);
+    EXPECT_EQ(2, trie.getNode("the cat sat")->getTimesSeen());
+    EXPECT_EQ(nullptr, trie.getNode("the cat ran"));
+
+    StringSequenceTrie::SequenceCriteria criteria;
+    criteria.setStartingSequence("extraordinarily");
+    criteria.m_frequency_min = 1;
+    // the starting word isn't counted, so these are the two words after it
+    std::vector<StringSequenceTrieNode*> sequences = trie.getOrderedWords(criteria);
+    ASSERT_EQ(2u, sequences.size());
+    std::vector<std::string> last_words = {trie.getWord(sequences[0]->getWordId()),
+                                           trie.getWord(sequences[1]->getWordId())};
+    std::sort(last_words.begin(), last_words.end());
+    EXPECT_EQ((std::vector<std::string>{"circumstances", "conversations"}), last_words);
+}
+
+TEST(teststringsequencetrie, testPreviousAndGapWords) {
+    StringSequenceTrie trie;
+    trie.addSequence(std::vector<std::string>{"the", "end", "of", "the", "road",
+        "the", "end", "of", "the", "day", "the", "top", "of", "the", "hill",
+        "a", "cup", "of", "tea", "the", "end"}, 5);
+
+    EXPECT_EQ("the", trie.getPreviousWord("end of"));
+    EXPECT_EQ("of", trie.getPreviousWord("the hill"));
+    // "zebra" was never seen, backs off to the words before "cup"
+    EXPECT_EQ("a", trie.getPreviousWord("cup zebra"));
+
+    std::vector<WordId> left = trie.getWordIds("the");
+    std::vector<WordId> right = trie.getWordIds("of");
+    std::vector<WordId> gap_words;
+    std::vector<double> scores;
+    EXPECT_EQ(2, trie.predictGapWords(left.data(), left.size(), right.data(),
+                                      right.size(), &gap_words, 4, &scores));
+    ASSERT_EQ(2u, gap_words.size());
+    EXPECT_EQ("end", trie.getWord(gap_words[0]));
+    EXPECT_EQ("top", trie.getWord(gap_words[1]));
+    EXPECT_EQ((std::vector<double>{2, 1}), scores);
+
+    EXPECT_EQ("cup", trie.getGapWord("a", "of tea"));
+    EXPECT_EQ("the", trie.getGapWord("end of", "day"));
+    // nothing fits between "tea" and "hill", backs off to the word before
+    // "hill"
+    EXPECT_EQ("the", trie.getGapWord("tea", "hill"));
+
+    // too long to have been counted whole, estimated through the gap word
+    left = trie.getWordIds("end of the");
+    right = trie.getWordIds("the end");
+    EXPECT_EQ(5, trie.predictGapWords(left.data(), left.size(), right.data(),
+                                      right.size(), &gap_words, 4, &scores));
+    ASSERT_EQ(1u, gap_words.size());
+    EXPECT_EQ("road", trie.getWord(gap_words[0]));
+    EXPECT_DOUBLE_EQ(1.0, scores[0]);
+}
+
+TEST(teststringsequencetrie, testCorpusReader) {
+    std::string buffer;
+    std::vector<std::string_view> words;
+    const std::string text = "  The cat's \"mat\", on\tthe-road... -- end\n";
+    CorpusReader::tokenize(text, &words, &buffer);
+    std::vector<std::string> expected = {"the", "cats", "mat", "on", "theroad...", "end"};
+    ASSERT_EQ(expected.size(), words.size());
+    for (std::size_t i = 0; i < expected.size(); i++)
+        EXPECT_EQ(expected[i], words[i]);
+    // clean words point straight into the text
+    EXPECT_EQ(text.data() + text.find("on"), words[3].data());
+
+    std::string word = "Don't!";
+    CorpusReader::cleanWord(&word);
+    EXPECT_EQ("dont", word);
+
+    // batches never split a word, whatever the batch size
+    const std::string filename = "testcorpusreader.txt";
+    std::string contents;
+    for (int i = 0; contents.size() < 3 * CorpusReader::kBatchBytes; i++)
+        contents += "Word" + std::to_string(i) + ", ";
+    std::ofstream outfile(filename, std::ios::binary);
+    outfile << contents;
+    outfile.close();
+
+    CorpusReader reader(filename);
+    ASSERT_TRUE(reader.isOpen());
+    int batches = 0;
+    int count = 0;
+    while (reader.nextBatch(&words)) {
+        batches++;
+        for (std::string_view read : words)
+            EXPECT_EQ("word" + std::to_string(count++), read);
+    }
+    EXPECT_GT(batches, 1);
+    EXPECT_EQ(contents.size(), reader.getText().size());
+    std::remove(filename.c_str());
+    EXPECT_FALSE(CorpusReader("testcorpusreader.txt").isOpen());
+}
+
+// every sequence of trie as text, with the times it was seen, in the order
+// getOrderedWords returns them
+static std::vector<std::pair<int, std::string>> orderedSequences(
+        const StringSequenceTrie &trie) {
+    StringSequenceTrie::SequenceCriteria criteria;
+    criteria.m_length_max_count = trie.getWindowSize();
+    criteria.m_length_min_count = 1;
+    criteria.m_frequency_min = 1;
+    std::vector<std::pair<int, std::string>> sequences;
+    for (const StringSequenceTrieNode* node : trie.getOrderedWords(criteria))
+        sequences.emplace_back(node->getTimesSeen(), trie.buildSequenceFromFinalNode(node));
+    return sequences;
+}
+
+TEST(teststringsequencetrie, testLoadTextFilesInParallel) {
+    // loadTextFiles reads from books/, which may have to be made
+    bool made_books = std::filesystem::create_directory("books");
+    const std::vector<std::string> names = {"testparallel0.txt", "testparallel1.txt",
+        "testparallel2.txt", "testparallelempty.txt", "testparallelmissing.txt"};
+    const char* vocabulary[] = {"the", "cat", "sat", "on", "a", "mat", "and", "dog",
+        "ran", "to", "river", "boat", "went", "down", "slowly", "town"};
+    std::srand(11);
+    // the first file is large enough to be cut into several chunks
+    for (int file = 0; file < 3; file++) {
+        std::ofstream outfile("books/" + names[file], std::ios::binary);
+        std::size_t bytes = file == 0 ? 300000 : 5000 * file;
+        for (std::size_t written = 0; written < bytes;) {
+            std::string sentence = "The";
+            for (int i = std::rand() % 10; i >= 0; i--)
+                sentence += std::string(" ") + vocabulary[std::rand() % 16];
+            sentence += std::rand() % 5 == 0 ? "!\n" : ". ";
+            outfile << sentence;
+            written += sentence.size();
+        }
+    }
+    std::ofstream(("books/" + names[3]).c_str()).close();
+
+    StringSequenceTrie one_at_a_time;
+    for (const std::string &name : names) one_at_a_time.loadTextFile(name, 4);
+    for (int thread_count : {1, 3}) {
+        StringSequenceTrie parallel;
+        parallel.loadTextFiles(names, 4, thread_count);
+        EXPECT_EQ(one_at_a_time.getNumberUniqueWords(), parallel.getNumberUniqueWords());
+        EXPECT_EQ(one_at_a_time.getNumberNodes(), parallel.getNumberNodes());
+
+        // ties may come out in either order, so compare counts in order and
+        // then the sequences themselves
+        std::vector<std::pair<int, std::string>> expected = orderedSequences(one_at_a_time);
+        std::vector<std::pair<int, std::string>> actual = orderedSequences(parallel);
+        ASSERT_GT(expected.size(), 100u);
+        ASSERT_EQ(expected.size(), actual.size());
+        for (std::size_t i = 0; i < expected.size(); i++)
+            ASSERT_EQ(expected[i].first, actual[i].first);
+        std::sort(expected.begin(), expected.end());
+        std::sort(actual.begin(), actual.end());
+        EXPECT_EQ(expected, actual);
+
+        // predictions may break ties differently, but must be seen as often
+        auto times_seen = [&one_at_a_time](const std::string &sequence) {
+            const StringSequenceTrieNode* node = one_at_a_time.getNode(sequence);
+            return node == nullptr ? 0 : node->getTimesSeen();
+        };
+        for (std::string sequence : {"the cat", "the river", "sat on a"}) {
+            EXPECT_EQ(times_seen(sequence + " " + one_at_a_time.getNextWord(sequence)),
+                      times_seen(sequence + " " + parallel.getNextWord(sequence)));
+            EXPECT_EQ(times_seen(one_at_a_time.getPreviousWord(sequence) + " " + sequence),
+                      times_seen(parallel.getPreviousWord(sequence) + " " + sequence));
+        }
+    }
+
+    for (const std::string &name : names) std::remove(("books/" + name).c_str());
+    if (made_books) std::filesystem::remove("books");
+}
+
+TEST(teststringsequencetrie, testTokenPipeline) {
+    TokenPipeline pipeline;
+    pipeline.addStopWord("A");
+    pipeline.addBlackListWord("damn");
+    std::string buffer;
+    std::vector<std::string_view> words;
+    pipeline.tokenize("Mr. Pip ran a mile. \"Who?\" said Joe, damn it!\n\nThe end...",
+                      &words, &buffer);
+    std::vector<std::string> expected = {"mr", "pip", "ran", "mile", "", "who", "",
+        "said", "joe", "", "it", "", "the", "end", ""};
+    ASSERT_EQ(expected.size(), words.size());
+    for (std::size_t i = 0; i < expected.size(); i++)
+        EXPECT_EQ(expected[i], words[i]);
+
+    // stages run in order after the word lists, and may shorten a word
+    pipeline.setSplitSentences(false);
+    pipeline.addStage([](std::string_view* word) {
+        if (word->size() > 3 && word->substr(word->size() - 3) == "ing")
+            word->remove_suffix(3);
+        return *word == "x" ? TokenPipeline::kEndSequence : TokenPipeline::kKeepWord;
+    });
+    words.clear();
+    pipeline.tokenize("Walking a dog. x Talking", &words, &buffer);
+    expected = {"walk", "dog.", "", "talk"};
+    ASSERT_EQ(expected.size(), words.size());
+    for (std::size_t i = 0; i < expected.size(); i++)
+        EXPECT_EQ(expected[i], words[i]);
+
+    // no sequence is counted across a sentence or a black listed word
+    StringSequenceTrie trie;
+    trie.getTokenPipeline().addBlackListWord("damn");
+    trie.addText("The cat sat. The cat ran damn the dog sat.", 3);
+    EXPECT_EQ(2, trie.getNode("the cat")->getTimesSeen());
+    EXPECT_EQ(nullptr, trie.getNode("sat the"));
+    EXPECT_EQ(nullptr, trie.getNode("ran the"));
+    EXPECT_EQ(nullptr, trie.getNode("damn"));
+    EXPECT_NE(nullptr, trie.getNode("the dog sat"));
+    EXPECT_EQ(kNoWord, trie.getWordId("sat."));
+
+    // nor across page separators
+    trie.addText("one two\n----------\nthree -- four", 3);
+    EXPECT_EQ(nullptr, trie.getNode("two three"));
+    EXPECT_NE(nullptr, trie.getNode("three four"));
+}
+
+TEST(teststringsequencetrie, testSequenceGenerator) {
+    StringSequenceTrie trie;
+    std::vector<std::string> words;
+    const char* text[] = {"the", "cat", "sat", "on", "the", "mat", "a", "b",
+                          "a", "b", "a", "b", "a", "c"};
+    for (int i = 0; i < 10; i++)
+        words.insert(words.end(), std::begin(text), std::end(text));
+    trie.addSequence(words, 3);
+
+    // every generated word continues a sequence seen in the text
+    SequenceGenerator generator(trie);
+    std::vector<WordId> generated;
+    generator.generate(2000, &generated);
+    ASSERT_EQ(2000u, generated.size());
+    for (std::size_t i = 1; i < generated.size(); i++) {
+        std::string pair = trie.getWord(generated[i - 1]) + " " +
+                           trie.getWord(generated[i]);
+        EXPECT_NE(nullptr, trie.getNode(pair)) << pair;
+    }
+
+    // "a" is followed by "b" 30 times and by "c" 10 times
+    const WordId a = trie.getWordId("a"), b = trie.getWordId("b");
+    auto share_of_b = [&](int samples) {
+        int seen = 0;
+        for (int i = 0; i < samples; i++) {
+            generator.setContext("a");
+            seen += generator.nextWord() == b;
+        }
+        return seen / static_cast<double>(samples);
+    };
+    EXPECT_NEAR(0.75, share_of_b(20000), 0.02);
+    generator.setTemperature(0.5);
+    EXPECT_NEAR(0.9, share_of_b(20000), 0.02);
+    generator.setTemperature(0);
+    EXPECT_EQ(1.0, share_of_b(100));
+    generator.setTemperature(1.0);
+    generator.setTopK(1);
+    EXPECT_EQ(1.0, share_of_b(100));
+
+    // the same seed gives the same text
+    SequenceGenerator first(trie, 1.0, 0, 42), second(trie, 1.0, 0, 42);
+    EXPECT_EQ(first.generateText(50), second.generateText(50));
+    second.setContext(&a, 1);
+    EXPECT_NE(kNoWord, second.nextWord());
+
+    StringSequenceTrie empty;
+    SequenceGenerator nothing(empty);
+    EXPECT_EQ(kNoWord, nothing.nextWord());
+    EXPECT_EQ("", nothing.generateText(10));
+}
+
+TEST(teststringsequencetrie, testConcurrentSnapshots) {
+    ConcurrentSequenceTrie trie;
+    const int rounds = 50;
+    std::atomic<bool> done(false);
+    std::atomic<int> failures(0);
+
+    // every round adds "a b" three times and publishes, so readers must only
+    // ever see whole rounds, never going back
+    auto reader = [&]() {
+        int last = 0;
+        while (!done.load()) {
+            ConcurrentSequenceTrie::Snapshot snapshot = trie.read();
+            const StringSequenceTrieNode* pair = snapshot->getNode("a b");
+            const StringSequenceTrieNode* first = snapshot->getNode("a");
+            int seen = pair == nullptr ? 0 : pair->getTimesSeen();
+            int first_seen = first == nullptr ? 0 : first->getTimesSeen();
+            if (seen % 3 != 0 || seen < last || first_seen != seen) failures++;
+            last = seen;
+        }
+    };
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; i++) readers.emplace_back(reader);
+
+    const std::vector<std::string> words = {"a", "b"};
+    for (int round = 1; round <= rounds; round++) {
+        for (int i = 0; i < 3; i++) trie.addSequence(words, 2);
+        EXPECT_EQ(static_cast<std::size_t>(round), trie.publish());
+    }
+    done.store(true);
+    for (std::thread &thread : readers) thread.join();
+
+    EXPECT_EQ(0, failures.load());
+    EXPECT_EQ(3 * rounds, trie.read()->getNode("a b")->getTimesSeen());
+
+    // unpublished changes stay invisible
+    trie.addText("a b c", 3);
+    EXPECT_EQ(nullptr, trie.read()->getNode("b c"));
+    trie.publish();
+    EXPECT_NE(nullptr, trie.read()->getNode("b c"));
+    trie.publish();
+    EXPECT_EQ(3 * rounds + 1, trie.read()->getNode("a b")->getTimesSeen());
+}